@@ -0,0 +1,40 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "lcf/encoder.h"
+#include "lcf/reader_util.h"
+
+using namespace lcf;
+
+static constexpr int iterations = 10000;
+
+template <typename F>
+static void Run(const char* name, F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	size_t sum = 0;
+	for (int i = 0; i < iterations; ++i) {
+		sum += f();
+	}
+	auto end = std::chrono::steady_clock::now();
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	std::cout << name << ": " << (double)ns / iterations << " ns/call"
+		<< " (checksum " << sum << ")" << std::endl;
+}
+
+int main() {
+	// Encoders are created for every load, save and Recode call
+	for (const char* encoding: { "1252", "932" }) {
+		const std::string enc_name = encoding;
+
+		Run(("construct " + enc_name).c_str(), [&]() {
+			Encoder enc(encoding);
+			return static_cast<size_t>(enc.IsOk());
+		});
+
+		Run(("Recode " + enc_name).c_str(), [&]() {
+			return ReaderUtil::Recode("Hero", encoding).size();
+		});
+	}
+
+	return 0;
+}
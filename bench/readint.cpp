@@ -0,0 +1,75 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+#include "lcf/reader_lcf.h"
+#include "lcf/writer_lcf.h"
+
+using namespace lcf;
+
+static constexpr int num_values = 1 << 20;
+static constexpr int iterations = 20;
+
+template <typename F>
+static void Run(const char* name, F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	int64_t sum = 0;
+	for (int i = 0; i < iterations; ++i) {
+		sum += f();
+	}
+	auto end = std::chrono::steady_clock::now();
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	std::cout << name << ": " << (double)ns / (double(num_values) * iterations) << " ns/int"
+		<< " (checksum " << sum << ")" << std::endl;
+}
+
+int main() {
+	// Mostly small values like in event command parameters
+	std::mt19937 rng(1234);
+	std::discrete_distribution<int> bytes_dist({ 70, 22, 5, 2, 1 });
+
+	std::stringstream ss;
+	{
+		LcfWriter writer(ss, EngineVersion::e2k);
+		for (int i = 0; i < num_values; ++i) {
+			int bits = 7 * (bytes_dist(rng) + 1);
+			int32_t v = static_cast<int32_t>(rng() & ((bits >= 32) ? 0xFFFFFFFFu : ((1u << bits) - 1)));
+			writer.WriteInt(v);
+		}
+	}
+	const auto str = ss.str();
+	const auto buf = std::vector<uint8_t>(str.begin(), str.end());
+	std::vector<int32_t> out(num_values);
+
+	Run("stream ReadInt", [&]() {
+		std::istringstream is(str);
+		LcfReader reader(is);
+		int64_t sum = 0;
+		for (int i = 0; i < num_values; ++i) {
+			sum += reader.ReadInt();
+		}
+		return sum;
+	});
+
+	Run("memory ReadInt", [&]() {
+		LcfReader reader(MakeSpan(buf));
+		int64_t sum = 0;
+		for (int i = 0; i < num_values; ++i) {
+			sum += reader.ReadInt();
+		}
+		return sum;
+	});
+
+	Run("memory ReadInts", [&]() {
+		LcfReader reader(MakeSpan(buf));
+		reader.ReadInts(out.data(), out.size());
+		int64_t sum = 0;
+		for (auto v: out) {
+			sum += v;
+		}
+		return sum;
+	});
+
+	return 0;
+}
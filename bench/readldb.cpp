@@ -1,18 +1,62 @@
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include "lcf/dbarena.h"
 #include "lcf/ldb/reader.h"
 
 using namespace lcf;
 
+#ifdef __GLIBC__
+// Count heap allocations of the whole process, including liblcf
+extern "C" void* __libc_malloc(size_t size);
+static size_t num_allocs = 0;
+
+extern "C" void* malloc(size_t size) {
+	++num_allocs;
+	return __libc_malloc(size);
+}
+#endif
+
 int main(int argc, char** argv) {
 	if (argc < 2) {
 		std::cerr << "Must specify a file!" << std::endl;
 		return 1;
 	}
 	const auto& infile = argv[1];
-	auto db = LDB_Reader::Load(infile, "");
-	if (db == nullptr) {
-		std::cerr << "Failed to load file : " << infile << std::endl;
-		return 1;
+	const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 1;
+	const std::string mode = argc > 3 ? argv[3] : "";
+	const bool use_arena = mode == "arena";
+	const bool parallel = mode == "parallel";
+
+#ifdef __GLIBC__
+	num_allocs = 0;
+#endif
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		std::unique_ptr<rpg::Database> db;
+		if (use_arena) {
+			DBArenaScope arena;
+			db = LDB_Reader::Load(infile, "");
+		} else if (parallel) {
+			db = LDB_Reader::LoadParallel(infile, "");
+		} else {
+			db = LDB_Reader::Load(infile, "");
+		}
+		if (db == nullptr) {
+			std::cerr << "Failed to load file : " << infile << std::endl;
+			return 1;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	if (iterations > 1) {
+		auto ms = std::chrono::duration<double, std::milli>(end - start).count();
+		std::cout << "Average load time: " << ms / iterations << " ms" << std::endl;
 	}
+#ifdef __GLIBC__
+	std::cout << "Average allocations: " << num_allocs / iterations << std::endl;
+#endif
 	return 0;
 }
@@ -172,6 +172,81 @@ def filter_size_fields(fields):
     for field in fields:
         if not field.size:
             yield field
+
+def chunk_table(fields):
+    # Splits the fields into a table directly indexed by chunk ID and
+    # a list sorted by chunk ID for the IDs that would leave the table mostly empty
+    by_code = OrderedDict()
+    for field in fields:
+        by_code[field.code] = field
+
+    codes = sorted(by_code)
+    dense_size = 1
+    for i, code in enumerate(codes):
+        if code < 32 or (i + 1) * 4 > code:
+            dense_size = code + 1
+
+    dense = [None] * dense_size
+    sparse = []
+    for code in codes:
+        if code < dense_size:
+            dense[code] = by_code[code]
+        else:
+            sparse.append(by_code[code])
+
+    return dict(dense=dense, sparse=sparse)
+
+# Seed of the bucket hash, must match TagHash in reader_struct.h
+tag_hash_base = 0x811C9DC5
+
+def tag_hash(name, seed):
+    # FNV-1a with a custom seed, must match TagHash in reader_struct.h
+    h = seed
+    for c in name.encode():
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h ^ (h >> 15)
+
+def place_tags(names, size):
+    buckets = [[] for _ in range(size)]
+    for name in names:
+        buckets[tag_hash(name, tag_hash_base) & (size - 1)].append(name)
+
+    slots = [None] * size
+    seeds = [0] * size
+    for b in sorted(range(size), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            break
+        for seed in range(1, 1 << 16):
+            pos = [tag_hash(name, seed) & (size - 1) for name in buckets[b]]
+            if len(set(pos)) == len(pos) and all(slots[p] is None for p in pos):
+                break
+        else:
+            return None
+        for name, p in zip(buckets[b], pos):
+            slots[p] = name
+        seeds[b] = seed
+    return seeds, slots
+
+def tag_table(fields):
+    # Perfect hash of the XML tag names (hash and displace): the names are
+    # grouped into buckets and every bucket gets a seed that moves all of
+    # its names to free slots of the table
+    by_name = OrderedDict()
+    for field in fields:
+        if lcf_type(field) not in ["Size", "Count"]:
+            by_name[field.name] = field
+
+    size = 1
+    while size < len(by_name):
+        size *= 2
+    while True:
+        table = place_tags(list(by_name), size)
+        if table is not None:
+            break
+        size *= 2
+
+    seeds, slots = table
+    return dict(seeds=seeds, slots=[None if name is None else by_name[name] for name in slots])
 # End of Jinja 2 functions
 
 int_types = {
@@ -533,6 +608,8 @@ def main(argv):
     env.filters["field_is_used"] = filter_unused_fields
     env.filters["field_is_written"] = filter_unwritten_fields
     env.filters["field_is_not_size"] = filter_size_fields
+    env.filters["chunk_table"] = chunk_table
+    env.filters["tag_table"] = tag_table
     env.filters["flag_size"] = flag_size
     env.filters["flag_set"] = flag_set
     env.filters["flags_for"] = flags_for
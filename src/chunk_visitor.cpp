@@ -0,0 +1,104 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include <cstring>
+
+#include "reader_struct.h"
+
+namespace lcf {
+
+namespace {
+
+/** @return the little endian integer at the start of data */
+uint64_t LoadLE(Span<const uint8_t> data, size_t n) {
+	uint64_t v = 0;
+	for (size_t i = 0; i < n; ++i) {
+		v |= uint64_t(data[i]) << (i * 8);
+	}
+	return v;
+}
+
+} // namespace
+
+bool ChunkWalk::ReadInt(Span<const uint8_t>& data, int32_t& value) {
+	// Same format as LcfReader::ReadInt: 7 bits per byte, big endian,
+	// the high bit marks that more bytes follow
+	uint32_t v = 0;
+	for (size_t i = 0; i < data.size() && i < 5; ++i) {
+		v = (v << 7) | (data[i] & 0x7F);
+		if ((data[i] & 0x80) == 0) {
+			value = static_cast<int32_t>(v);
+			data = data.subspan(i + 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+template <>
+void PrimitiveVisitor<bool>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	if (chunk.data.size() >= 1) {
+		visitor.Integer(chunk, chunk.data[0] != 0);
+	}
+}
+
+template <>
+void PrimitiveVisitor<int8_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	if (chunk.data.size() >= 1) {
+		visitor.Integer(chunk, static_cast<int8_t>(chunk.data[0]));
+	}
+}
+
+template <>
+void PrimitiveVisitor<uint8_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	if (chunk.data.size() >= 1) {
+		visitor.Integer(chunk, chunk.data[0]);
+	}
+}
+
+template <>
+void PrimitiveVisitor<int16_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	if (chunk.data.size() >= 2) {
+		visitor.Integer(chunk, static_cast<int16_t>(LoadLE(chunk.data, 2)));
+	}
+}
+
+template <>
+void PrimitiveVisitor<uint32_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	if (chunk.data.size() >= 4) {
+		visitor.Integer(chunk, static_cast<uint32_t>(LoadLE(chunk.data, 4)));
+	}
+}
+
+template <>
+void PrimitiveVisitor<int32_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	// Empty chunks are read as 0 by Primitive<int32_t>
+	int32_t value = 0;
+	auto data = chunk.data;
+	if (data.empty() || (data.size() <= 5 && ChunkWalk::ReadInt(data, value))) {
+		visitor.Integer(chunk, value);
+	}
+}
+
+template <>
+void PrimitiveVisitor<double>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	if (chunk.data.size() >= 8) {
+		const uint64_t bits = LoadLE(chunk.data, 8);
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		visitor.Double(chunk, value);
+	}
+}
+
+template <>
+void PrimitiveVisitor<std::string>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+	visitor.String(chunk, std::string_view(reinterpret_cast<const char*>(chunk.data.data()), chunk.data.size()));
+}
+
+} // namespace lcf
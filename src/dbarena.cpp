@@ -0,0 +1,117 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/dbarena.h"
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+namespace lcf {
+
+namespace {
+
+// Blocks are aligned to their size, this way the block of an allocation
+// is found by masking the address.
+constexpr size_t block_size = 64 * 1024;
+// Larger allocations go to the heap to keep the waste at the block end low
+constexpr size_t max_alloc = block_size / 8;
+
+struct Block {
+	/** Number of live allocations plus one while the scope uses the block */
+	std::atomic<size_t> refs;
+};
+
+constexpr size_t block_header = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+thread_local DBArenaScope* current = nullptr;
+
+Block* BlockOf(void* p) {
+	return reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(block_size - 1));
+}
+
+char* AlignUp(char* p, size_t align) {
+	return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + align - 1) & ~uintptr_t(align - 1));
+}
+
+void Unref(Block* block) noexcept {
+	if (block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		block->~Block();
+		::operator delete(block, std::align_val_t(block_size));
+	}
+}
+
+} // namespace
+
+DBArenaScope::DBArenaScope() : _prev(current) {
+	current = this;
+}
+
+DBArenaScope::~DBArenaScope() {
+	ReleaseBlock();
+	current = _prev;
+}
+
+bool DBArenaScope::IsActive() {
+	return current != nullptr;
+}
+
+void* DBArenaScope::Alloc(size_t size, size_t align) {
+	auto* scope = current;
+	if (scope == nullptr || size > max_alloc) {
+		return nullptr;
+	}
+
+	auto* p = AlignUp(scope->_top, align);
+	if (scope->_block == nullptr || size > static_cast<size_t>(scope->_end - p)) {
+		scope->NewBlock();
+		p = AlignUp(scope->_top, align);
+	}
+
+	scope->_top = p + size;
+	scope->_last = p;
+	static_cast<Block*>(scope->_block)->refs.fetch_add(1, std::memory_order_relaxed);
+	return p;
+}
+
+void DBArenaScope::Free(void* p) noexcept {
+	Unref(BlockOf(p));
+}
+
+void DBArenaScope::Shrink(void* p, size_t size) noexcept {
+	auto* scope = current;
+	if (scope != nullptr && scope->_last == p) {
+		scope->_top = scope->_last + size;
+	}
+}
+
+void DBArenaScope::NewBlock() {
+	ReleaseBlock();
+
+	auto* raw = static_cast<char*>(::operator new(block_size, std::align_val_t(block_size)));
+	auto* block = new (raw) Block();
+	// Reference held by the scope
+	block->refs.store(1, std::memory_order_relaxed);
+
+	_block = block;
+	_top = raw + block_header;
+	_end = raw + block_size;
+	_last = nullptr;
+}
+
+void DBArenaScope::ReleaseBlock() noexcept {
+	if (_block != nullptr) {
+		Unref(static_cast<Block*>(_block));
+		_block = nullptr;
+		_top = nullptr;
+		_end = nullptr;
+		_last = nullptr;
+	}
+}
+
+} // namespace lcf
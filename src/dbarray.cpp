@@ -1,8 +1,14 @@
 #include "lcf/dbarrayalloc.h"
 #include "lcf/dbarray.h"
 #include "lcf/dbstring.h"
+#include "lcf/dbarena.h"
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
 
 //#define LCF_DEBUG_DBARRAY
 
@@ -22,22 +28,47 @@ static size_t AllocSize(size_t size, size_t align) {
 	return HeaderSize(align) + size;
 }
 
+// Shared storage keeps its reference count in front of the size
+static ptrdiff_t SharedHeaderSize(size_t align) {
+	return std::max(2 * sizeof(DBArrayAlloc::size_type), align);
+}
+
+static std::atomic<DBArrayAlloc::size_type>* GetRefs(void* p) {
+	return reinterpret_cast<std::atomic<DBArrayAlloc::size_type>*>(DBArrayAlloc::get_size_ptr(p) - 1);
+}
+
+// Sizes from corrupted files must not reach the flags of the size header
+static void CheckFieldSize(size_t field_size) {
+	if (field_size > DBArrayAlloc::max_size) {
+		throw std::length_error("DBArray size " + std::to_string(field_size) + " too large");
+	}
+}
+
 static void* Adjust(void* p, ptrdiff_t off) {
 	return reinterpret_cast<void*>(reinterpret_cast<intptr_t>(p) + off);
 }
 
-void* DBArrayAlloc::alloc(size_type size, size_type field_size, size_type align) {
+void* DBArrayAlloc::alloc(size_t size, size_t field_size, size_type align) {
 	if (field_size == 0) {
 		return empty_buf();
 	}
 	assert(align <= alignof(std::max_align_t));
-	auto* raw = ::operator new(AllocSize(size, align));
+	CheckFieldSize(field_size);
+	auto flag = arena_flag;
+	auto* raw = DBArenaScope::Alloc(AllocSize(size, align), HeaderSize(align));
+	if (raw == nullptr) {
+		flag = 0;
+		raw = std::malloc(AllocSize(size, align));
+		if (raw == nullptr) {
+			throw std::bad_alloc();
+		}
+	}
 	auto* p = Adjust(raw, HeaderSize(align));
-	*get_size_ptr(p) = field_size;
+	*get_size_ptr(p) = static_cast<size_type>(field_size) | flag;
 #ifdef LCF_DEBUG_DBARRAY
 	std::cout << "DBArray: Allocated"
 		<< " size=" << size
-		<< " field_size=" << *get_size_ptr(p)
+		<< " field_size=" << get_size(p)
 		<< " align=" << align
 		<< " ptr=" << raw
 		<< " adjusted=" << p
@@ -46,8 +77,37 @@ void* DBArrayAlloc::alloc(size_type size, size_type field_size, size_type align)
 	return p;
 }
 
+void* DBArrayAlloc::alloc_shared(size_t size, size_t field_size, size_type align) {
+	if (field_size == 0) {
+		return empty_buf();
+	}
+	assert(align <= alignof(std::max_align_t));
+	CheckFieldSize(field_size);
+	static_assert(sizeof(std::atomic<size_type>) == sizeof(size_type), "refcount must fit the header");
+	auto* raw = std::malloc(SharedHeaderSize(align) + size);
+	if (raw == nullptr) {
+		throw std::bad_alloc();
+	}
+	auto* p = Adjust(raw, SharedHeaderSize(align));
+	new (GetRefs(p)) std::atomic<size_type>(1);
+	*get_size_ptr(p) = static_cast<size_type>(field_size) | shared_flag;
+	return p;
+}
+
+void* DBArrayAlloc::ref_shared(void* p) noexcept {
+	assert(is_shared(p));
+	GetRefs(p)->fetch_add(1, std::memory_order_relaxed);
+	return p;
+}
+
 void DBArrayAlloc::free(void* p, size_type align) noexcept {
 	assert(p != nullptr);
+	if (p != empty_buf() && is_shared(p)) {
+		if (GetRefs(p)->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			std::free(Adjust(p, -SharedHeaderSize(align)));
+		}
+		return;
+	}
 	if (p != empty_buf()) {
 		auto* raw = Adjust(p, -HeaderSize(align));
 #ifdef LCF_DEBUG_DBARRAY
@@ -55,14 +115,43 @@ void DBArrayAlloc::free(void* p, size_type align) noexcept {
 			<< " align=" << align
 			<< " ptr=" << raw
 			<< " adjusted=" << p
-			<< " field_size=" << *get_size_ptr(p)
+			<< " field_size=" << get_size(p)
 			<< std::endl;
 #endif
-		::operator delete(raw);
+		if (*get_size_ptr(p) & arena_flag) {
+			DBArenaScope::Free(raw);
+		} else {
+			std::free(raw);
+		}
+	}
+}
+
+void* DBArrayAlloc::realloc(void* p, size_t size, size_t field_size, size_type align) {
+	assert(p != nullptr);
+	if (p == empty_buf()) {
+		return alloc(size, field_size, align);
+	}
+	if (field_size == 0) {
+		free(p, align);
+		return empty_buf();
+	}
+	assert(!is_shared(p));
+	auto* raw = Adjust(p, -HeaderSize(align));
+	if (*get_size_ptr(p) & arena_flag) {
+		DBArenaScope::Shrink(raw, AllocSize(size, align));
+		*get_size_ptr(p) = static_cast<size_type>(field_size) | arena_flag;
+		return p;
+	}
+	raw = std::realloc(raw, AllocSize(size, align));
+	if (raw == nullptr) {
+		throw std::bad_alloc();
 	}
+	p = Adjust(raw, HeaderSize(align));
+	*get_size_ptr(p) = static_cast<size_type>(field_size);
+	return p;
 }
 
-char* DBString::construct_z(const char* s, size_t len) {
+void* DBString::construct_z(const char* s, size_t len) {
 	auto* p = alloc(len);
 	if (len) {
 		std::memcpy(p, s, len + 1);
@@ -70,7 +159,7 @@ char* DBString::construct_z(const char* s, size_t len) {
 	return p;
 }
 
-char* DBString::construct_sv(const char* s, size_t len) {
+void* DBString::construct_sv(const char* s, size_t len) {
 	auto* p = alloc(len);
 	if (len) {
 		std::memcpy(p, s, len);
@@ -79,10 +168,48 @@ char* DBString::construct_sv(const char* s, size_t len) {
 	return p;
 }
 
+void* DBString::construct_shared(const char* s, size_t len) {
+	assert(len > inline_capacity);
+	auto* p = reinterpret_cast<char*>(DBArrayAlloc::alloc_shared(len + 1, len, 1));
+	std::memcpy(p, s, len);
+	p[len] = '\0';
+	return p;
+}
+
+void* DBString::copy() const {
+	if (is_inline()) {
+		return _storage;
+	}
+	if (DBArrayAlloc::is_shared(_storage)) {
+		return DBArrayAlloc::ref_shared(_storage);
+	}
+	return construct_z(data(), size());
+}
+
+void DBString::unshare() {
+	auto* p = construct_z(c_str(), size());
+	destroy();
+	_storage = p;
+}
+
+void* DBString::shrink(char* p, size_t len) {
+	if (len > 0 && len <= inline_capacity) {
+		auto* storage = construct_inline(p, len);
+		free(p);
+		return storage;
+	}
+	p = reinterpret_cast<char*>(DBArrayAlloc::realloc(p, len + 1, len, 1));
+	if (len) {
+		p[len] = '\0';
+	}
+	return p;
+}
+
 DBString& DBString::operator=(const DBString& o) {
 	if (this != &o) {
+		auto* p = o.copy();
 		destroy();
-		_storage = construct_z(o.data(), o.size());
+		_storage = p;
 	}
 	return *this;
 }
@@ -53,7 +53,7 @@ void RawStruct<DBString>::WriteLcf(const DBString& ref, LcfWriter& stream) {
 }
 
 int RawStruct<DBString>::LcfSize(const DBString& ref, LcfWriter& stream) {
-	return stream.Decode(ref).size();
+	return stream.DecodeBuffered(ref).size();
 }
 
 void RawStruct<DBString>::WriteXml(const DBString& ref, XmlWriter& stream) {
@@ -127,9 +127,9 @@ void RawStruct<std::vector<DBString>>::WriteLcf(const std::vector<DBString>& ref
 			gap_size = 0;
 		}
 
-		auto len = RawStruct<DBString>::LcfSize(e, stream);
-		stream.WriteInt(len);
-		RawStruct<DBString>::WriteLcf(e, stream);
+		auto str = stream.DecodeBuffered(e);
+		stream.WriteInt(str.size());
+		stream.Write(str.data(), 1, str.size());
 	}
 }
 
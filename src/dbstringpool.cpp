@@ -0,0 +1,70 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/dbstringpool.h"
+#include <cstring>
+
+namespace lcf {
+
+namespace {
+
+thread_local DBStringPool* current = nullptr;
+
+} // namespace
+
+DBStringPool::Scope::Scope(DBStringPool& pool) : _prev(current) {
+	current = &pool;
+}
+
+DBStringPool::Scope::~Scope() {
+	current = _prev;
+}
+
+DBStringPool* DBStringPool::Current() {
+	return current;
+}
+
+DBString DBStringPool::Intern(std::string_view str) {
+	if (str.size() <= DBString::inline_capacity) {
+		// Stored inline, nothing to share
+		return DBString::Create(str.size(), [&](char* dst) {
+			std::memcpy(dst, str.data(), str.size());
+			return str.size();
+		});
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_stats.lookups;
+
+	auto it = _strings.find(str);
+	if (it != _strings.end()) {
+		_stats.bytes_saved += str.size();
+		return it->second;
+	}
+
+	DBString s;
+	s._storage = DBString::construct_shared(str.data(), str.size());
+	const auto key = std::string_view(s);
+	_stats.unique_strings++;
+	_stats.unique_bytes += str.size();
+	return _strings.emplace(key, std::move(s)).first->second;
+}
+
+DBStringPool::Stats DBStringPool::GetStats() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+void DBStringPool::Clear() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_strings.clear();
+	_stats = {};
+}
+
+} // namespace lcf
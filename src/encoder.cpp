@@ -32,6 +32,22 @@
 #   include <locale>
 #endif
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define LCF_ENCODER_SSE2
+#   ifdef __AVX2__
+#       include <immintrin.h>
+#   endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define LCF_ENCODER_NEON
+#endif
+
 namespace lcf {
 
 static std::string filterUtf8Compatible(std::string enc) {
@@ -48,6 +64,48 @@ static std::string filterUtf8Compatible(std::string enc) {
 	return enc;
 }
 
+/** @return whether all bytes of the string are below 0x80 */
+static bool IsAscii(std::string_view str) {
+	const auto* p = reinterpret_cast<const uint8_t*>(str.data());
+	const auto* end = p + str.size();
+
+#ifdef __AVX2__
+	for (; end - p >= 32; p += 32) {
+		const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		if (_mm256_movemask_epi8(v) != 0) {
+			return false;
+		}
+	}
+#endif
+#if defined(LCF_ENCODER_SSE2)
+	for (; end - p >= 16; p += 16) {
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if (_mm_movemask_epi8(v) != 0) {
+			return false;
+		}
+	}
+#elif defined(LCF_ENCODER_NEON)
+	for (; end - p >= 16; p += 16) {
+		if (vmaxvq_u8(vld1q_u8(p)) >= 0x80) {
+			return false;
+		}
+	}
+#endif
+	for (; end - p >= 8; p += 8) {
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		if (v & UINT64_C(0x8080808080808080)) {
+			return false;
+		}
+	}
+	for (; p != end; ++p) {
+		if (*p & 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
 Encoder::Encoder(std::string encoding)
 	: _encoding(filterUtf8Compatible(std::move(encoding)))
 {
@@ -62,21 +120,93 @@ bool Encoder::IsOk() const {
 	return _encoding.empty() || (_conv_storage && _conv_runtime);
 }
 
+bool Encoder::IsPassthrough(std::string_view str) const {
+	return _tables->ascii_compatible && IsAscii(str)
+		&& (_tables->ascii_exceptions.empty() || str.find_first_of(_tables->ascii_exceptions) == std::string_view::npos);
+}
+
 void Encoder::Encode(std::string& str) {
 	if (_encoding.empty() || str.empty()) {
 		return;
 	}
+	if (IsPassthrough(str)) {
+		return;
+	}
+#if LCF_SUPPORT_ICU
+	if (!_tables->sb_to_utf8.empty()) {
+		_buffer.resize(EncodeSizeBound(str));
+		str.assign(_buffer.data(), EncodeSingleByte(str, _buffer.data()));
+		return;
+	}
+#endif
+	Convert(str, _conv_runtime, _conv_storage);
+}
+
+size_t Encoder::Encode(std::string_view src, char* dst) {
+	if (_encoding.empty() || src.empty() || IsPassthrough(src)) {
+		if (!src.empty()) {
+			std::memcpy(dst, src.data(), src.size());
+		}
+		return src.size();
+	}
+#if LCF_SUPPORT_ICU
+	if (!_tables->sb_to_utf8.empty()) {
+		return EncodeSingleByte(src, dst);
+	}
+	return Convert(src, dst, src.size() * 4, _conv_runtime, _conv_storage);
+#else
+	if (_conv_runtime == 65001) {
+		return EncodeWindows1252(src, dst);
+	}
+	// Unsupported encoding
+	auto str = ToString(src);
 	Convert(str, _conv_runtime, _conv_storage);
+	std::memcpy(dst, str.data(), str.size());
+	return str.size();
+#endif
+}
+
+size_t Encoder::EncodeSizeBound(std::string_view src) const {
+	if (_encoding.empty() || IsPassthrough(src)) {
+		return src.size();
+	}
+#if LCF_SUPPORT_ICU
+	if (!_tables->sb_to_utf8.empty()) {
+		size_t size = 0;
+		for (unsigned char ch: src) {
+			size += _tables->sb_to_utf8[ch].size;
+		}
+		return size;
+	}
+	return src.size() * 4;
+#else
+	return src.size() * 2;
+#endif
+}
+
+bool Encoder::NeedsConversion(std::string_view str) const {
+	return !_encoding.empty() && !str.empty() && !IsPassthrough(str);
 }
 
 void Encoder::Decode(std::string& str) {
 	if (_encoding.empty() || str.empty()) {
 		return;
 	}
+	if (IsPassthrough(str)) {
+		return;
+	}
+#if LCF_SUPPORT_ICU
+	if (!_tables->sb_from_utf8.empty() && DecodeSingleByte(str)) {
+		return;
+	}
+#endif
 	Convert(str, _conv_storage, _conv_runtime);
 }
 
 void Encoder::Init() {
+	static const auto no_tables = std::make_shared<const Tables>();
+	_tables = no_tables;
+
 	if (_encoding.empty()) {
 		return;
 	}
@@ -109,17 +239,57 @@ void Encoder::Init() {
 
 	_conv_runtime = conv_runtime;
 	_conv_storage = conv_storage;
+
+	_tables = GetTables(storage_encoding);
 #else
 	if (storage_encoding != "windows-1252") {
 		return;
 	}
 
+	static const auto windows_1252 = std::make_shared<const Tables>(Tables{ true, {}, {}, {} });
 	_conv_runtime = 65001;
 	_conv_storage = 1252;
+	_tables = windows_1252;
 #endif
 }
 
 #if LCF_SUPPORT_ICU
+std::shared_ptr<const Encoder::Tables> Encoder::GetTables(const std::string& storage_encoding) {
+	// Building the tables converts every byte, far more expensive than opening the converters
+	static std::mutex mutex;
+	static std::unordered_map<std::string, std::shared_ptr<const Tables>> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& tables = cache[storage_encoding];
+	if (!tables) {
+		tables = BuildTables();
+	}
+	return tables;
+}
+
+std::shared_ptr<const Encoder::Tables> Encoder::BuildTables() {
+	auto tables = std::make_shared<Tables>();
+
+	// Check which ASCII characters pass through the conversion unchanged
+	std::string exceptions;
+	for (int i = 0; i < 0x80; ++i) {
+		const std::string ch(1, static_cast<char>(i));
+		auto encoded = ch;
+		Convert(encoded, _conv_runtime, _conv_storage);
+		auto decoded = ch;
+		Convert(decoded, _conv_storage, _conv_runtime);
+		if (encoded != ch || decoded != ch) {
+			exceptions += ch;
+		}
+	}
+	// Only worth it when nearly all of ASCII is unchanged
+	tables->ascii_compatible = exceptions.size() <= 8;
+	tables->ascii_exceptions = std::move(exceptions);
+
+	InitSingleByte(*tables);
+	return tables;
+}
+
 void Encoder::Reset() {
 	if (_conv_runtime) {
 		ucnv_close(_conv_runtime);
@@ -132,28 +302,130 @@ void Encoder::Reset() {
 	}
 }
 
+void Encoder::InitSingleByte(Tables& tables) {
+	if (!tables.ascii_compatible || !tables.ascii_exceptions.empty() || ucnv_getMaxCharSize(_conv_storage) != 1) {
+		return;
+	}
+
+	// Single byte encodings convert every byte on its own,
+	// so the conversion of all 256 bytes describes the whole encoding.
+	std::vector<SingleByteChar> to_utf8(256);
+	std::vector<std::pair<uint32_t, char>> from_utf8;
+
+	for (int i = 0; i < 256; ++i) {
+		std::string ch(1, static_cast<char>(i));
+		auto utf8 = ch;
+		Convert(utf8, _conv_runtime, _conv_storage);
+		if (utf8.empty() || utf8.size() > sizeof(SingleByteChar::utf8)) {
+			return;
+		}
+		auto& entry = to_utf8[i];
+		std::memcpy(entry.utf8, utf8.data(), utf8.size());
+		entry.size = static_cast<uint8_t>(utf8.size());
+
+		if (i < 0x80) {
+			continue;
+		}
+
+		// Only use mappings that convert back to the same byte,
+		// everything else is handled by ICU
+		auto back = utf8;
+		Convert(back, _conv_storage, _conv_runtime);
+		if (back != ch) {
+			continue;
+		}
+
+		uint32_t codepoint = static_cast<uint8_t>(utf8[0]);
+		if (utf8.size() > 1) {
+			codepoint &= 0xFF >> (utf8.size() + 1);
+			for (size_t j = 1; j < utf8.size(); ++j) {
+				codepoint = (codepoint << 6) | (static_cast<uint8_t>(utf8[j]) & 0x3F);
+			}
+		}
+		from_utf8.emplace_back(codepoint, ch[0]);
+	}
+
+	std::sort(from_utf8.begin(), from_utf8.end());
+	tables.sb_to_utf8 = std::move(to_utf8);
+	tables.sb_from_utf8 = std::move(from_utf8);
+}
+
+size_t Encoder::EncodeSingleByte(std::string_view src, char* dst) {
+	auto* dst_p = dst;
+	for (unsigned char ch: src) {
+		const auto& entry = _tables->sb_to_utf8[ch];
+		std::memcpy(dst_p, entry.utf8, entry.size);
+		dst_p += entry.size;
+	}
+	return dst_p - dst;
+}
+
+bool Encoder::DecodeSingleByte(std::string& str) {
+	_buffer.resize(str.size());
+
+	auto* dst_p = _buffer.data();
+	const auto* src_p = reinterpret_cast<const uint8_t*>(str.data());
+	const auto* src_end = src_p + str.size();
+
+	while (src_p != src_end) {
+		uint32_t codepoint = *src_p;
+		if (codepoint < 0x80) {
+			*dst_p++ = static_cast<char>(codepoint);
+			++src_p;
+			continue;
+		}
+
+		int len = codepoint >= 0xF0 ? 4 : codepoint >= 0xE0 ? 3 : codepoint >= 0xC0 ? 2 : 0;
+		if (len == 0 || src_end - src_p < len) {
+			// Invalid UTF-8, let ICU handle the error
+			return false;
+		}
+		codepoint &= 0xFF >> (len + 1);
+		for (int i = 1; i < len; ++i) {
+			if ((src_p[i] & 0xC0) != 0x80) {
+				return false;
+			}
+			codepoint = (codepoint << 6) | (src_p[i] & 0x3F);
+		}
+
+		const auto& from_utf8 = _tables->sb_from_utf8;
+		auto it = std::lower_bound(from_utf8.begin(), from_utf8.end(), codepoint,
+				[](const std::pair<uint32_t, char>& e, uint32_t cp) { return e.first < cp; });
+		if (it == from_utf8.end() || it->first != codepoint) {
+			// Not in the encoding, use the substitution rules of ICU
+			return false;
+		}
+		*dst_p++ = it->second;
+		src_p += len;
+	}
+
+	str.assign(_buffer.data(), dst_p);
+	return true;
+}
+
 void Encoder::Convert(std::string& str, UConverter* conv_dst, UConverter* conv_src) {
-	const auto& src = str;
+	_buffer.resize(str.size() * 4);
+	str.assign(_buffer.data(), Convert(str, _buffer.data(), _buffer.size(), conv_dst, conv_src));
+}
 
+size_t Encoder::Convert(std::string_view src, char* dst, size_t dst_size, UConverter* conv_dst, UConverter* conv_src) {
 	auto status = U_ZERO_ERROR;
-	_buffer.resize(src.size() * 4);
 
-	const auto* src_p = src.c_str();
-	auto* dst_p = _buffer.data();
+	const auto* src_p = src.data();
+	auto* dst_p = dst;
 
 	ucnv_convertEx(conv_dst, conv_src,
-			&dst_p, dst_p + _buffer.size(),
+			&dst_p, dst + dst_size,
 			&src_p, src_p + src.size(),
 			nullptr, nullptr, nullptr, nullptr,
 			true, true,
 			&status);
 
 	if (U_FAILURE(status)) {
-		Log::Error("ucnv_convertEx() error when encoding \"%s\": %s", src.c_str(), u_errorName(status));
-		_buffer.clear();
+		Log::Error("ucnv_convertEx() error when encoding \"%s\": %s", ToString(src).c_str(), u_errorName(status));
 	}
 
-	str.assign(_buffer.data(), dst_p);
+	return dst_p - dst;
 }
 #else
 void Encoder::Convert(std::string& str, int conv_dst, int) {
@@ -164,21 +436,8 @@ void Encoder::Convert(std::string& str, int conv_dst, int) {
 	size_t buf_idx = 0;
 
 	if (conv_dst == 65001) {
-		// From 1252 to UTF-8
-		// Based on https://stackoverflow.com/q/4059775/
 		_buffer.resize(str.size() * 2 + 1);
-
-		for (unsigned char ch: str) {
-			if (ch < 0x80) {
-				_buffer[buf_idx] = static_cast<char>(ch);
-			} else {
-				_buffer[buf_idx] = static_cast<char>(0xC0 | (ch >> 6));
-				++buf_idx;
-				_buffer[buf_idx] = static_cast<char>(0x80 | (ch & 0x3F));
-			}
-
-			++buf_idx;
-		}
+		buf_idx = EncodeWindows1252(str, _buffer.data());
 	} else {
 		// From UTF-8 to 1252
 		// Based on https://stackoverflow.com/q/23689733/
@@ -213,6 +472,26 @@ void Encoder::Convert(std::string& str, int conv_dst, int) {
 
 	str.assign(_buffer.data(), buf_idx);
 }
+
+size_t Encoder::EncodeWindows1252(std::string_view src, char* dst) {
+	// From 1252 to UTF-8
+	// Based on https://stackoverflow.com/q/4059775/
+	size_t buf_idx = 0;
+
+	for (unsigned char ch: src) {
+		if (ch < 0x80) {
+			dst[buf_idx] = static_cast<char>(ch);
+		} else {
+			dst[buf_idx] = static_cast<char>(0xC0 | (ch >> 6));
+			++buf_idx;
+			dst[buf_idx] = static_cast<char>(0x80 | (ch & 0x3F));
+		}
+
+		++buf_idx;
+	}
+
+	return buf_idx;
+}
 #endif
 
 } //namespace lcf
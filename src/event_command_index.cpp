@@ -0,0 +1,125 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/event_command_index.h"
+#include "lcf/event_command_list.h"
+#include <algorithm>
+
+namespace lcf {
+
+namespace {
+
+struct CommandInfo {
+	int32_t code;
+	int32_t indent;
+	int32_t param0;
+};
+
+constexpr uint32_t none = UINT32_MAX;
+
+} // namespace
+
+EventCommandIndex::EventCommandIndex(const std::vector<rpg::EventCommand>& commands) {
+	Build(commands.size(), [&](size_t i) {
+		const auto& cmd = commands[i];
+		return CommandInfo{ cmd.code, cmd.indent, cmd.parameters.empty() ? 0 : cmd.parameters[0] };
+	});
+}
+
+EventCommandIndex::EventCommandIndex(const EventCommandList& commands) {
+	Build(commands.size(), [&](size_t i) {
+		const auto params = commands.parameters(i);
+		return CommandInfo{ commands.code(i), commands.indent(i), params.empty() ? 0 : params[0] };
+	});
+}
+
+template <typename F>
+void EventCommandIndex::Build(size_t count, F&& get) {
+	_next.assign(count, none);
+	_prev.assign(count, none);
+	_parent.assign(count, none);
+	_labels.clear();
+
+	// Last command of every open block, indents are increasing
+	std::vector<std::pair<int32_t, uint32_t>> open;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const auto cmd = get(i);
+
+		while (!open.empty() && open.back().first > cmd.indent) {
+			open.pop_back();
+		}
+
+		if (!open.empty() && open.back().first == cmd.indent) {
+			const auto prev = open.back().second;
+			_next[prev] = i;
+			_prev[i] = prev;
+			open.pop_back();
+		}
+		if (!open.empty()) {
+			_parent[i] = open.back().second;
+		}
+		open.emplace_back(cmd.indent, i);
+
+		if (cmd.code == static_cast<int32_t>(rpg::EventCommand::Code::Label)) {
+			_labels.emplace_back(cmd.param0, i);
+		}
+	}
+
+	// Stable to keep the first label of an id in front
+	std::stable_sort(_labels.begin(), _labels.end(), [](const auto& l, const auto& r) {
+		return l.first < r.first;
+	});
+}
+
+size_t EventCommandIndex::FindLabel(int32_t id) const {
+	auto it = std::lower_bound(_labels.begin(), _labels.end(), id, [](const auto& l, int32_t id) {
+		return l.first < id;
+	});
+	if (it == _labels.end() || it->first != id) {
+		return npos;
+	}
+	return it->second;
+}
+
+EventCommandIndexCache::EventCommandIndexCache(const EventCommandIndexCache& o)
+	: _index(std::atomic_load(&o._index)) {
+}
+
+EventCommandIndexCache& EventCommandIndexCache::operator=(const EventCommandIndexCache& o) {
+	if (this != &o) {
+		std::atomic_store(&_index, std::atomic_load(&o._index));
+	}
+	return *this;
+}
+
+template <typename T>
+std::shared_ptr<const EventCommandIndex> EventCommandIndexCache::GetImpl(const T& commands) const {
+	auto index = std::atomic_load(&_index);
+	// The size check catches commands added or removed without Reset
+	if (!index || index->size() != commands.size()) {
+		index = std::make_shared<const EventCommandIndex>(commands);
+		std::atomic_store(&_index, index);
+	}
+	return index;
+}
+
+std::shared_ptr<const EventCommandIndex> EventCommandIndexCache::Get(const std::vector<rpg::EventCommand>& commands) const {
+	return GetImpl(commands);
+}
+
+std::shared_ptr<const EventCommandIndex> EventCommandIndexCache::Get(const EventCommandList& commands) const {
+	return GetImpl(commands);
+}
+
+void EventCommandIndexCache::Reset() {
+	std::atomic_store(&_index, std::shared_ptr<const EventCommandIndex>());
+}
+
+} // namespace lcf
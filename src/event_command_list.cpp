@@ -0,0 +1,130 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/event_command_list.h"
+#include <algorithm>
+
+namespace lcf {
+
+EventCommandList::EventCommandList(const std::vector<rpg::EventCommand>& commands) {
+	size_t num_parameters = 0;
+	size_t num_chars = 0;
+	for (const auto& cmd: commands) {
+		num_parameters += cmd.parameters.size();
+		num_chars += cmd.string.size();
+	}
+
+	_codes.reserve(commands.size());
+	_indents.reserve(commands.size());
+	_parameter_offsets.reserve(commands.size() + 1);
+	_string_offsets.reserve(commands.size() + 1);
+	_parameters.reserve(num_parameters);
+	_strings.reserve(num_chars);
+
+	for (const auto& cmd: commands) {
+		push_back(cmd.code, cmd.indent, cmd.string, Span<const int32_t>(cmd.parameters.data(), cmd.parameters.size()));
+	}
+}
+
+std::vector<rpg::EventCommand> EventCommandList::ToVector() const {
+	std::vector<rpg::EventCommand> commands(size());
+	for (size_t i = 0; i < size(); ++i) {
+		auto& cmd = commands[i];
+		cmd.code = code(i);
+		cmd.indent = indent(i);
+		cmd.string = DBString(string(i));
+		auto params = parameters(i);
+		cmd.parameters = DBArray<int32_t>(params.begin(), params.end());
+	}
+	return commands;
+}
+
+std::shared_ptr<const EventCommandIndex> EventCommandList::Index() const {
+	return _index.Get(*this);
+}
+
+void EventCommandList::push_back(int32_t code, int32_t indent, std::string_view string, Span<const int32_t> parameters) {
+	_index.Reset();
+	_codes.push_back(code);
+	_indents.push_back(indent);
+	_parameters.insert(_parameters.end(), parameters.begin(), parameters.end());
+	_parameter_offsets.push_back(static_cast<uint32_t>(_parameters.size()));
+	_strings.append(string.data(), string.size());
+	_string_offsets.push_back(static_cast<uint32_t>(_strings.size()));
+}
+
+/** Inserts an entry of size bytes at position pos into the offset table and shifts the following ones. */
+static void InsertOffset(std::vector<uint32_t>& offsets, size_t pos, size_t size) {
+	offsets.insert(offsets.begin() + pos + 1, offsets[pos]);
+	for (size_t i = pos + 1; i < offsets.size(); ++i) {
+		offsets[i] += static_cast<uint32_t>(size);
+	}
+}
+
+/** Removes the entry at position pos from the offset table and shifts the following ones. */
+static void EraseOffset(std::vector<uint32_t>& offsets, size_t pos) {
+	const auto size = offsets[pos + 1] - offsets[pos];
+	offsets.erase(offsets.begin() + pos + 1);
+	for (size_t i = pos + 1; i < offsets.size(); ++i) {
+		offsets[i] -= size;
+	}
+}
+
+void EventCommandList::insert(size_t pos, int32_t code, int32_t indent, std::string_view string, Span<const int32_t> parameters) {
+	if (pos == size()) {
+		push_back(code, indent, string, parameters);
+		return;
+	}
+
+	_index.Reset();
+	_codes.insert(_codes.begin() + pos, code);
+	_indents.insert(_indents.begin() + pos, indent);
+	_parameters.insert(_parameters.begin() + _parameter_offsets[pos], parameters.begin(), parameters.end());
+	InsertOffset(_parameter_offsets, pos, parameters.size());
+	_strings.insert(_string_offsets[pos], string.data(), string.size());
+	InsertOffset(_string_offsets, pos, string.size());
+}
+
+void EventCommandList::erase(size_t pos) {
+	_index.Reset();
+	_codes.erase(_codes.begin() + pos);
+	_indents.erase(_indents.begin() + pos);
+	_parameters.erase(_parameters.begin() + _parameter_offsets[pos], _parameters.begin() + _parameter_offsets[pos + 1]);
+	EraseOffset(_parameter_offsets, pos);
+	_strings.erase(_string_offsets[pos], _string_offsets[pos + 1] - _string_offsets[pos]);
+	EraseOffset(_string_offsets, pos);
+}
+
+void EventCommandList::set_parameters(size_t pos, Span<const int32_t> parameters) {
+	_index.Reset();
+	const auto begin = _parameters.begin() + _parameter_offsets[pos];
+	const auto old_size = _parameter_offsets[pos + 1] - _parameter_offsets[pos];
+	if (parameters.size() == old_size) {
+		std::copy(parameters.begin(), parameters.end(), begin);
+		return;
+	}
+	// Replace by erasing and inserting the parameters and fixing the offsets
+	_parameters.erase(begin, begin + old_size);
+	_parameters.insert(_parameters.begin() + _parameter_offsets[pos], parameters.begin(), parameters.end());
+	for (size_t i = pos + 1; i < _parameter_offsets.size(); ++i) {
+		_parameter_offsets[i] = _parameter_offsets[i] - old_size + static_cast<uint32_t>(parameters.size());
+	}
+}
+
+void EventCommandList::clear() {
+	_index.Reset();
+	_codes.clear();
+	_indents.clear();
+	_parameter_offsets.resize(1);
+	_string_offsets.resize(1);
+	_parameters.clear();
+	_strings.clear();
+}
+
+} // namespace lcf
@@ -0,0 +1,87 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_CHUNK_VISITOR_H
+#define LCF_CHUNK_VISITOR_H
+
+#include <cstdint>
+#include "lcf/span.h"
+#include "lcf/string_view.h"
+
+namespace lcf {
+
+/**
+ * Receives the chunk tree of an LCF file from LDB_Reader::Visit,
+ * LMU_Reader::Visit or LSD_Reader::Visit without building the rpg objects.
+ *
+ * The walk is depth first. For every struct BeginStruct is called, then
+ * BeginChunk, the value callback and EndChunk for each of its chunks and
+ * finally EndStruct. Chunks holding structs or arrays of structs report
+ * them before their EndChunk, one level deeper.
+ *
+ * Integers, doubles and strings are decoded and passed to the value
+ * callbacks. All other chunks (arrays, flags, event commands) only expose
+ * their bytes through Chunk::data. Strings are passed in the encoding of
+ * the file. All data points into the buffer passed to Visit, nothing is
+ * allocated during the walk.
+ */
+class ChunkVisitor {
+	public:
+		struct Chunk {
+			/** Name of the struct containing the chunk */
+			const char* struct_name = nullptr;
+			/** Name of the field, empty for size chunks and nullptr for unknown chunks */
+			const char* field_name = nullptr;
+			/** Chunk ID */
+			uint32_t id = 0;
+			/** Nesting level, 0 for the chunks of the root struct */
+			int depth = 0;
+			/** Contents of the chunk */
+			Span<const uint8_t> data;
+		};
+
+		virtual ~ChunkVisitor() = default;
+
+		/**
+		 * Called when a struct starts.
+		 *
+		 * @param struct_name name of the struct.
+		 * @param id ID of elements of struct arrays, 0 otherwise.
+		 * @param depth nesting level of the chunks of the struct.
+		 * @return false to skip the chunks of the struct, EndStruct is not called.
+		 */
+		virtual bool BeginStruct(const char* /* struct_name */, int32_t /* id */, int /* depth */) { return true; }
+
+		/** Called when a struct ends. */
+		virtual void EndStruct(const char* /* struct_name */, int32_t /* id */, int /* depth */) {}
+
+		/**
+		 * Called when a chunk starts.
+		 *
+		 * @return false to skip the value and the nested structs of the chunk,
+		 *         EndChunk is not called.
+		 */
+		virtual bool BeginChunk(const Chunk& /* chunk */) { return true; }
+
+		/** Called when a chunk ends. */
+		virtual void EndChunk(const Chunk& /* chunk */) {}
+
+		/** Value of chunks holding a bool or an integer. */
+		virtual void Integer(const Chunk& /* chunk */, int64_t /* value */) {}
+
+		/** Value of chunks holding a double. */
+		virtual void Double(const Chunk& /* chunk */, double /* value */) {}
+
+		/** Value of chunks holding a string, in the encoding of the file. */
+		virtual void String(const Chunk& /* chunk */, std::string_view /* value */) {}
+};
+
+} // namespace lcf
+
+#endif
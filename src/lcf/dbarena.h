@@ -0,0 +1,72 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_DBARENA_H
+#define LCF_DBARENA_H
+#include <cstddef>
+
+namespace lcf {
+
+/**
+ * While alive, DBString, DBArray and DBBitArray storage allocated by the
+ * current thread is carved out of large blocks instead of the heap.
+ *
+ * A block is released as soon as the last object allocated from it is
+ * destroyed, so tearing down a loaded database only frees a handful of
+ * blocks. Objects may outlive the scope and copies made after the scope
+ * ended use the heap as usual.
+ *
+ * @code
+ * std::unique_ptr<lcf::rpg::Database> db;
+ * {
+ * 	lcf::DBArenaScope arena;
+ * 	db = lcf::LDB_Reader::Load(filename, encoding);
+ * }
+ * @endcode
+ */
+class DBArenaScope {
+	public:
+		DBArenaScope();
+		~DBArenaScope();
+
+		DBArenaScope(const DBArenaScope&) = delete;
+		DBArenaScope& operator=(const DBArenaScope&) = delete;
+
+		/** @return whether a scope is active on the current thread */
+		static bool IsActive();
+
+		/**
+		 * Allocates from the active scope of the current thread.
+		 *
+		 * @param size bytes to allocate
+		 * @param align alignment of the allocation
+		 * @return the memory or nullptr when no scope is active or size is too large
+		 */
+		static void* Alloc(size_t size, size_t align);
+
+		/** Releases memory returned by Alloc. */
+		static void Free(void* p) noexcept;
+
+		/** Gives back the tail of the most recent allocation. */
+		static void Shrink(void* p, size_t size) noexcept;
+
+	private:
+		void NewBlock();
+		void ReleaseBlock() noexcept;
+
+		DBArenaScope* _prev = nullptr;
+		void* _block = nullptr;
+		char* _top = nullptr;
+		char* _end = nullptr;
+		char* _last = nullptr;
+};
+
+} // namespace lcf
+
+#endif
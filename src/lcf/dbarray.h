@@ -99,11 +99,11 @@ class DBArray {
 		const_reverse_iterator crend() const { return rend(); }
 
 		bool empty() const { return size() == 0; }
-		size_type size() const { return *DBArrayAlloc::get_size_ptr(_storage); }
+		size_type size() const { return DBArrayAlloc::get_size(_storage); }
 
 	private:
 		T* alloc(size_t count) {
-			return reinterpret_cast<T*>(DBArrayAlloc::alloc(static_cast<size_type>(count * sizeof(T)), static_cast<size_type>(count), static_cast<size_type>(alignof(T))));
+			return reinterpret_cast<T*>(DBArrayAlloc::alloc(count * sizeof(T), count, static_cast<size_type>(alignof(T))));
 		}
 
 		void free(void* p) {
@@ -23,8 +23,27 @@ struct DBArrayAlloc {
 	using size_type = uint32_t;
 	using ssize_type = int32_t;
 
-	static void* alloc(size_type size, size_type field_size, size_type align);
+	/** Throws std::length_error when field_size is larger than max_size. */
+	static void* alloc(size_t size, size_t field_size, size_type align);
 	static void free(void* p, size_type align) noexcept;
+	/** Shrinks an allocation made by alloc(). */
+	static void* realloc(void* p, size_t size, size_t field_size, size_type align);
+
+	/** Marks storage which was allocated from a DBArenaScope. */
+	static constexpr size_type arena_flag = size_type(1) << 31;
+	/** Marks reference counted storage, see alloc_shared(). */
+	static constexpr size_type shared_flag = size_type(1) << 30;
+	/** Largest field size, the bits above it hold the flags. */
+	static constexpr size_type max_size = shared_flag - 1;
+
+	/** Allocates storage with a reference count of 1 which is never allocated from an arena. */
+	static void* alloc_shared(size_t size, size_t field_size, size_type align);
+	/** Adds a reference to storage made by alloc_shared(), free() drops it. */
+	static void* ref_shared(void* p) noexcept;
+
+	static bool is_shared(const void* p) {
+		return (*get_size_ptr(p) & shared_flag) != 0;
+	}
 
 	static void* empty_buf() {
 		return const_cast<size_type*>(&_empty_buf[1]);
@@ -38,6 +57,10 @@ struct DBArrayAlloc {
 		return static_cast<const size_type*>(p) - 1;
 	}
 
+	static size_type get_size(const void* p) {
+		return *get_size_ptr(p) & ~(arena_flag | shared_flag);
+	}
+
 	private:
 	static const size_type _empty_buf[2];
 };
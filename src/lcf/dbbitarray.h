@@ -178,7 +178,11 @@ class DBBitArray {
 		const_reverse_iterator crend() const { return rend(); }
 
 		bool empty() const { return size() == 0; }
-		size_type size() const { return *DBArrayAlloc::get_size_ptr(_storage); }
+		size_type size() const { return DBArrayAlloc::get_size(_storage); }
+
+		/** @return the packed bits, bit i is stored in bit (i % 8) of byte (i / 8) */
+		uint8_t* bytes() { return static_cast<uint8_t*>(_storage); }
+		const uint8_t* bytes() const { return static_cast<const uint8_t*>(_storage); }
 
 		void set_all() { std::memset(_storage, 0xff, bytes_up_from_bits(size())); }
 		void reset_all() { std::memset(_storage, 0, bytes_up_from_bits(size())); }
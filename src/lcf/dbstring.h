@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <ostream>
 
+#include "lcf/config.h"
 #include "lcf/dbarrayalloc.h"
 
 namespace lcf {
@@ -24,6 +25,19 @@ namespace lcf {
 // A custom string class optimized for database storage.
 // This string type is good for storing and retrieving values.
 // It is not good for string manipulation like insertion or concatenation.
+//
+// Strings of up to inline_capacity bytes created by Create() (used by the
+// readers) or by a DBStringPool are stored inside the object (tagged pointer
+// with the lowest bit set), so data() of such strings and their copies
+// changes when the string is moved. Strings created by the constructors are
+// always allocated and keep their data() across moves.
+//
+// Strings created by a DBStringPool share their storage with all copies.
+// The non-const accessors (data(), operator[], front(), back(), begin(),
+// end() and the reverse iterators) copy shared storage on their first call,
+// so pointers taken before that call do not point into the string anymore
+// and iterating a non-const pooled string allocates once. Use the const
+// accessors to read pooled strings without copying them.
 class DBString {
 	public:
 		using value_type = char;
@@ -40,6 +54,9 @@ class DBString {
 
 		static constexpr size_type npos = size_type(-1);
 
+		/** Longest string Create() stores without a heap allocation */
+		static constexpr size_t inline_capacity = sizeof(void*) - 2;
+
 		constexpr DBString() = default;
 		explicit DBString(std::string_view s) : _storage(construct_sv(s.data(), s.size())) {}
 		explicit DBString(const std::string& s) : _storage(construct_z(s.c_str(), s.size())) {}
@@ -51,12 +68,23 @@ class DBString {
 			DBString(const char(&literal)[N]) : _storage(construct_z(literal, N - 1)) {}
 		DBString(const char* s, size_t len) : DBString(std::string_view(s, len)) {}
 
-		DBString(const DBString& o) : DBString(std::string_view(o)) {}
+		DBString(const DBString& o) : _storage(o.copy()) {}
 		DBString(DBString&& o) noexcept { swap(o); }
 
 		DBString& operator=(const DBString&);
 		DBString& operator=(DBString&&) noexcept;
 
+		/**
+		 * Creates a string by writing directly into its storage.
+		 * The storage is shrunk to the written size afterwards,
+		 * short strings are stored inline (see the class comment).
+		 *
+		 * @param max_size upper bound of the string size
+		 * @param fill callable fill(char* dst) returning the written size
+		 */
+		template <typename F>
+		static DBString Create(size_t max_size, F&& fill);
+
 		void swap(DBString& o) noexcept {
 			std::swap(_storage, o._storage);
 		}
@@ -75,8 +103,19 @@ class DBString {
 		char& back() { return (*this)[size()-1]; }
 		char back() const { return (*this)[size()-1]; }
 
-		char* data() { return static_cast<char*>(_storage); }
-		const char* data() const { return static_cast<const char*>(_storage); }
+		/** Copies storage shared through a DBStringPool, see the class comment. */
+		char* data() {
+			if (is_inline()) {
+				return inline_data();
+			}
+			if (DBArrayAlloc::is_shared(_storage)) {
+				unshare();
+			}
+			return static_cast<char*>(_storage);
+		}
+		const char* data() const {
+			return is_inline() ? const_cast<DBString*>(this)->inline_data() : static_cast<const char*>(_storage);
+		}
 
 		const char* c_str() const { return data(); }
 
@@ -99,18 +138,50 @@ class DBString {
 		const_reverse_iterator crend() const { return rend(); }
 
 		bool empty() const { return size() == 0; }
-		size_type size() const { return *DBArrayAlloc::get_size_ptr(_storage); }
+		size_type size() const {
+			return is_inline() ? static_cast<size_type>((reinterpret_cast<uintptr_t>(_storage) & 0xFF) >> 1) : DBArrayAlloc::get_size(_storage);
+		}
 
 	private:
-		char* alloc(size_t count) {
-			return reinterpret_cast<char*>(DBArrayAlloc::alloc(static_cast<size_type>(count + 1), static_cast<size_type>(count), 1));
+		friend class DBStringPool;
+
+#if LCF_WORDS_BIGENDIAN
+		// The lowest byte of the pointer is the last one
+		static constexpr size_t tag_offset = sizeof(void*) - 1;
+		static constexpr size_t inline_offset = 0;
+#else
+		static constexpr size_t tag_offset = 0;
+		static constexpr size_t inline_offset = 1;
+#endif
+
+		bool is_inline() const {
+			return (reinterpret_cast<uintptr_t>(_storage) & 1) != 0;
+		}
+		char* inline_data() {
+			return reinterpret_cast<char*>(&_storage) + inline_offset;
+		}
+		/** @return inline storage holding len bytes of s, followed by zeros */
+		static void* construct_inline(const char* s, size_t len) {
+			void* storage = nullptr;
+			auto* bytes = reinterpret_cast<unsigned char*>(&storage);
+			std::memcpy(bytes + inline_offset, s, len);
+			bytes[tag_offset] |= static_cast<unsigned char>((len << 1) | 1);
+			return storage;
+		}
+
+		static char* alloc(size_t count) {
+			return reinterpret_cast<char*>(DBArrayAlloc::alloc(count + 1, count, 1));
 		}
 		void free(void* p) {
 			DBArrayAlloc::free(p, 1);
 		}
 		void destroy() noexcept;
-		char* construct_z(const char* s, size_t len);
-		char* construct_sv(const char* s, size_t len);
+		static void* construct_z(const char* s, size_t len);
+		static void* construct_sv(const char* s, size_t len);
+		static void* construct_shared(const char* s, size_t len);
+		void* copy() const;
+		void unshare();
+		void* shrink(char* p, size_t len);
 	private:
 		void* _storage = DBArrayAlloc::empty_buf();
 };
@@ -161,11 +232,31 @@ inline DBString& DBString::operator=(DBString&& o) noexcept {
 	return *this;
 }
 
+template <typename F>
+inline DBString DBString::Create(size_t max_size, F&& fill) {
+	DBString s;
+	if (max_size > 0 && max_size <= inline_capacity) {
+		// Zero filled, the string is terminated whatever size is written
+		s._storage = nullptr;
+		const auto size = fill(s.inline_data());
+		if (size > 0) {
+			reinterpret_cast<unsigned char*>(&s._storage)[tag_offset] |= static_cast<unsigned char>((size << 1) | 1);
+		} else {
+			s._storage = DBArrayAlloc::empty_buf();
+		}
+	} else if (max_size > 0) {
+		auto* p = s.alloc(max_size);
+		s._storage = p;
+		s._storage = s.shrink(p, fill(p));
+	}
+	return s;
+}
+
 inline void DBString::destroy() noexcept {
-	if (_storage != DBArrayAlloc::empty_buf()) {
+	if (!is_inline() && _storage != DBArrayAlloc::empty_buf()) {
 		free(_storage);
-		_storage = DBArrayAlloc::empty_buf();
 	}
+	_storage = DBArrayAlloc::empty_buf();
 }
 
 } // namespace lcf
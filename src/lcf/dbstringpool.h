@@ -0,0 +1,100 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_DBSTRINGPOOL_H
+#define LCF_DBSTRINGPOOL_H
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+#include "lcf/dbstring.h"
+#include "lcf/string_view.h"
+
+namespace lcf {
+
+/**
+ * Deduplicates DBString storage.
+ *
+ * Identical strings returned by Intern share one reference counted
+ * allocation. Copying such a DBString only adds a reference and modifying
+ * it makes a private copy first. Strings stay valid after the pool is
+ * destroyed.
+ *
+ * While a DBStringPool::Scope is alive, strings read by the LCF readers on
+ * that thread are interned. Use one pool for all files of a project:
+ *
+ * @code
+ * lcf::DBStringPool pool;
+ * {
+ * 	lcf::DBStringPool::Scope scope(pool);
+ * 	db = lcf::LDB_Reader::Load(ldb, encoding);
+ * 	tree = lcf::LMT_Reader::Load(lmt, encoding);
+ * 	map = lcf::LMU_Reader::Load(lmu, encoding);
+ * }
+ * @endcode
+ *
+ * All functions are thread-safe.
+ */
+class DBStringPool {
+	public:
+		struct Stats {
+			/** Number of distinct strings in the pool */
+			size_t unique_strings = 0;
+			/** Bytes used by the distinct strings */
+			size_t unique_bytes = 0;
+			/** Number of Intern calls for strings too long to be stored inline */
+			size_t lookups = 0;
+			/** Bytes not allocated because the string was already pooled */
+			size_t bytes_saved = 0;
+		};
+
+		/** Makes a pool the current pool of the calling thread while alive. */
+		class Scope {
+			public:
+				explicit Scope(DBStringPool& pool);
+				~Scope();
+
+				Scope(const Scope&) = delete;
+				Scope& operator=(const Scope&) = delete;
+
+			private:
+				DBStringPool* _prev = nullptr;
+		};
+
+		DBStringPool() = default;
+		~DBStringPool() = default;
+
+		DBStringPool(const DBStringPool&) = delete;
+		DBStringPool& operator=(const DBStringPool&) = delete;
+
+		/** @return the pool of the active Scope on the calling thread or nullptr */
+		static DBStringPool* Current();
+
+		/**
+		 * @param str string to look up.
+		 * @return a string sharing the storage of all identical interned strings.
+		 */
+		DBString Intern(std::string_view str);
+
+		/** @return usage statistics */
+		Stats GetStats() const;
+
+		/** Drops the references of the pool, interned strings stay valid. */
+		void Clear();
+
+	private:
+		mutable std::mutex _mutex;
+		/** Keys point into the storage of the values */
+		std::unordered_map<std::string_view, DBString> _strings;
+		Stats _stats;
+};
+
+} // namespace lcf
+
+#endif
@@ -11,8 +11,12 @@
 #define LCF_ENCODER_H
 
 #include "lcf/config.h"
-#include <vector>
+#include "lcf/string_view.h"
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #if LCF_SUPPORT_ICU
 class UConverter;
@@ -36,6 +40,21 @@ class Encoder {
 		 */
 		void Encode(std::string& str);
 
+		/**
+		 * Converts from the specified encoding to UTF-8 into a buffer
+		 *
+		 * @param src String to encode to UTF-8
+		 * @param dst Buffer with space for EncodeSizeBound(src) bytes
+		 * @return Number of bytes written to dst
+		 */
+		size_t Encode(std::string_view src, char* dst);
+
+		/**
+		 * @param src String to encode to UTF-8
+		 * @return Upper bound of the size of src after encoding it to UTF-8
+		 */
+		size_t EncodeSizeBound(std::string_view src) const;
+
 		/**
 		 * Converts from UTF-8 to the specified encoding
 		 *
@@ -43,14 +62,44 @@ class Encoder {
 		 */
 		void Decode(std::string& str);
 
+		/**
+		 * @param str String to encode or decode
+		 * @return false when Encode and Decode leave str unchanged
+		 */
+		bool NeedsConversion(std::string_view str) const;
+
 		bool IsOk() const;
 
 		std::string_view GetEncoding() const;
 	private:
+		/** UTF-8 sequence of a byte of a single byte encoding */
+		struct SingleByteChar {
+			char utf8[4];
+			uint8_t size;
+		};
+
+		/** Conversion properties of a storage encoding, shared by all Encoders of it */
+		struct Tables {
+			/** Storage encoding maps 0x00-0x7F to ASCII, ASCII strings need no conversion */
+			bool ascii_compatible = false;
+			/** ASCII bytes that are converted despite ascii_compatible (e.g. control codes in Shift-JIS) */
+			std::string ascii_exceptions;
+			/** Storage to UTF-8 table of single byte encodings, empty otherwise */
+			std::vector<SingleByteChar> sb_to_utf8;
+			/** Codepoint to byte table of single byte encodings, sorted by codepoint */
+			std::vector<std::pair<uint32_t, char>> sb_from_utf8;
+		};
+
 #if LCF_SUPPORT_ICU
 		void Init();
+		std::shared_ptr<const Tables> GetTables(const std::string& storage_encoding);
+		std::shared_ptr<const Tables> BuildTables();
+		void InitSingleByte(Tables& tables);
 		void Reset();
 		void Convert(std::string& str, UConverter* conv_dst, UConverter* conv_src);
+		size_t Convert(std::string_view src, char* dst, size_t dst_size, UConverter* conv_dst, UConverter* conv_src);
+		size_t EncodeSingleByte(std::string_view src, char* dst);
+		bool DecodeSingleByte(std::string& str);
 
 		UConverter* _conv_storage = nullptr;
 		UConverter* _conv_runtime = nullptr;
@@ -58,12 +107,17 @@ class Encoder {
 		void Init();
 		void Reset() {}
 		void Convert(std::string& str, int conv_dst, int conv_src);
+		static size_t EncodeWindows1252(std::string_view src, char* dst);
 
 		int _conv_storage = 0;
 		int _conv_runtime = 0;
 #endif
 		std::vector<char> _buffer;
 		std::string _encoding;
+		/** Never null, built once per storage encoding */
+		std::shared_ptr<const Tables> _tables;
+
+		bool IsPassthrough(std::string_view str) const;
 };
 
 
@@ -0,0 +1,120 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_EVENT_COMMAND_INDEX_H
+#define LCF_EVENT_COMMAND_INDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "lcf/rpg/eventcommand.h"
+
+namespace lcf {
+
+class EventCommandList;
+
+/**
+ * Jump table of an event command list, built from the indent and code of
+ * every command.
+ *
+ * Block commands (ConditionalBranch, ShowChoice, Loop, ...) are followed by
+ * their body at a deeper indent and by their next clause (ElseBranch,
+ * ShowChoiceOption, ...) or end command at their own indent. Next() maps a
+ * command to that partner, which makes skipping a block constant time.
+ *
+ * The index does not track changes to the list it was built from, use
+ * EventCommandIndexCache to keep one next to the list.
+ */
+class EventCommandIndex {
+	public:
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		EventCommandIndex() = default;
+		explicit EventCommandIndex(const std::vector<rpg::EventCommand>& commands);
+		explicit EventCommandIndex(const EventCommandList& commands);
+
+		/** @return number of indexed commands */
+		size_t size() const { return _next.size(); }
+
+		/**
+		 * @return the next command at the same indent before the block
+		 *         ends, e.g. the ElseBranch or EndBranch of a ConditionalBranch
+		 *         or the EndLoop of a Loop. npos if there is none.
+		 */
+		size_t Next(size_t i) const { return Get(_next, i); }
+
+		/**
+		 * @return the previous command at the same indent within the block,
+		 *         e.g. the Loop of an EndLoop. npos if there is none.
+		 */
+		size_t Previous(size_t i) const { return Get(_prev, i); }
+
+		/**
+		 * @return the command that opened the block containing i,
+		 *         npos for top level commands.
+		 */
+		size_t Parent(size_t i) const { return Get(_parent, i); }
+
+		/** @return the first Label command with the given id or npos */
+		size_t FindLabel(int32_t id) const;
+
+	private:
+		template <typename F>
+		void Build(size_t count, F&& get);
+
+		static size_t Get(const std::vector<uint32_t>& v, size_t i) {
+			return v[i] == UINT32_MAX ? npos : v[i];
+		}
+
+		std::vector<uint32_t> _next;
+		std::vector<uint32_t> _prev;
+		std::vector<uint32_t> _parent;
+		/** (label id, command index) sorted by id */
+		std::vector<std::pair<int32_t, uint32_t>> _labels;
+};
+
+/**
+ * Lazily built EventCommandIndex of an event command list, held next to
+ * the commands by rpg::EventPage, rpg::CommonEvent and EventCommandList.
+ *
+ * The index is swapped atomically, so concurrent const access is safe;
+ * two threads may both build it on first use. A returned index is
+ * immutable and stays alive after the commands change. Copies share the
+ * index until they are reset, moves take it over.
+ */
+class EventCommandIndexCache {
+	public:
+		EventCommandIndexCache() = default;
+		EventCommandIndexCache(const EventCommandIndexCache& o);
+		EventCommandIndexCache& operator=(const EventCommandIndexCache& o);
+		EventCommandIndexCache(EventCommandIndexCache&& o) noexcept = default;
+		EventCommandIndexCache& operator=(EventCommandIndexCache&& o) noexcept = default;
+
+		/**
+		 * @return the index of commands, built on first use. An index of
+		 *         another size than commands is rebuilt.
+		 */
+		std::shared_ptr<const EventCommandIndex> Get(const std::vector<rpg::EventCommand>& commands) const;
+		std::shared_ptr<const EventCommandIndex> Get(const EventCommandList& commands) const;
+
+		/** Drops the index, must be called when the commands were modified. */
+		void Reset();
+
+	private:
+		template <typename T>
+		std::shared_ptr<const EventCommandIndex> GetImpl(const T& commands) const;
+
+		/** Only accessed with std::atomic_load and std::atomic_store */
+		mutable std::shared_ptr<const EventCommandIndex> _index;
+};
+
+} // namespace lcf
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_EVENT_COMMAND_LIST_H
+#define LCF_EVENT_COMMAND_LIST_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "lcf/span.h"
+#include "lcf/string_view.h"
+#include "lcf/event_command_index.h"
+#include "lcf/rpg/eventcommand.h"
+
+namespace lcf {
+
+class LcfReader;
+class LcfWriter;
+
+/**
+ * Compact storage for the event commands of one page or common event.
+ *
+ * Codes and indents are kept in parallel arrays while all parameters and
+ * strings share one pool each, so a list costs a handful of allocations
+ * regardless of its length and walking it touches contiguous memory.
+ *
+ * The readers still store std::vector<rpg::EventCommand> in rpg::EventPage
+ * and rpg::CommonEvent. LDB_Reader::LoadEventCommands and
+ * LMU_Reader::LoadEventCommands read the lists of a file directly into this
+ * form without building the vectors.
+ */
+class EventCommandList {
+	public:
+		/** Read-only view of a command, valid until the list is modified. */
+		struct Command {
+			int32_t code;
+			int32_t indent;
+			std::string_view string;
+			Span<const int32_t> parameters;
+		};
+
+		EventCommandList() = default;
+		explicit EventCommandList(const std::vector<rpg::EventCommand>& commands);
+
+		/** @return the commands as regular rpg::EventCommand objects */
+		std::vector<rpg::EventCommand> ToVector() const;
+
+		size_t size() const { return _codes.size(); }
+		bool empty() const { return _codes.empty(); }
+
+		int32_t code(size_t i) const { return _codes[i]; }
+		int32_t indent(size_t i) const { return _indents[i]; }
+
+		std::string_view string(size_t i) const {
+			return std::string_view(_strings).substr(_string_offsets[i], _string_offsets[i + 1] - _string_offsets[i]);
+		}
+
+		Span<const int32_t> parameters(size_t i) const {
+			return Span<const int32_t>(_parameters.data() + _parameter_offsets[i], _parameter_offsets[i + 1] - _parameter_offsets[i]);
+		}
+
+		Command operator[](size_t i) const {
+			return { code(i), indent(i), string(i), parameters(i) };
+		}
+
+		/**
+		 * Returns the jump table of the list. It is built on first use and
+		 * rebuilt after the list was modified. Safe to call concurrently.
+		 */
+		std::shared_ptr<const EventCommandIndex> Index() const;
+
+		/** Appends a command. */
+		void push_back(int32_t code, int32_t indent, std::string_view string, Span<const int32_t> parameters);
+
+		/** Inserts a command before position pos. */
+		void insert(size_t pos, int32_t code, int32_t indent, std::string_view string, Span<const int32_t> parameters);
+
+		/** Removes the command at position pos. */
+		void erase(size_t pos);
+
+		/** Replaces the parameters of the command at position pos. */
+		void set_parameters(size_t pos, Span<const int32_t> parameters);
+
+		void clear();
+
+		/**
+		 * Replaces the content with an event command list chunk.
+		 *
+		 * @param stream reader positioned at the chunk data.
+		 * @param length chunk length.
+		 */
+		void ReadLcf(LcfReader& stream, uint32_t length);
+
+		/** Writes the list in the same format as std::vector<rpg::EventCommand>. */
+		void WriteLcf(LcfWriter& stream) const;
+
+	private:
+		std::vector<int32_t> _codes;
+		std::vector<int32_t> _indents;
+		/** size() + 1 offsets into _parameters */
+		std::vector<uint32_t> _parameter_offsets = { 0 };
+		/** size() + 1 offsets into _strings */
+		std::vector<uint32_t> _string_offsets = { 0 };
+		std::vector<int32_t> _parameters;
+		std::string _strings;
+		EventCommandIndexCache _index;
+};
+
+} // namespace lcf
+
+#endif
@@ -14,14 +14,78 @@
 #include <vector>
 #include <memory>
 #include "lcf/rpg/database.h"
+#include "lcf/ldb/chunks.h"
+#include "lcf/chunk_visitor.h"
+#include "lcf/event_command_list.h"
 #include "lcf/saveopt.h"
+#include "lcf/span.h"
 
 namespace lcf {
 
+class LcfReader;
+class MappedFile;
+
 /**
  * LDB Reader namespace.
  */
 namespace LDB_Reader {
+	/**
+	 * Database whose top-level sections are parsed on first access.
+	 *
+	 * Opening only records the offset and length of every section,
+	 * the data itself is decoded by Get.
+	 */
+	class LazyDatabase {
+		public:
+			~LazyDatabase();
+
+			LazyDatabase(const LazyDatabase&) = delete;
+			LazyDatabase& operator=(const LazyDatabase&) = delete;
+
+			/**
+			 * Parses a section unless it was parsed before.
+			 *
+			 * @param section top-level chunk of the database.
+			 * @return the database, sections that were not requested yet are empty.
+			 */
+			rpg::Database& Get(ChunkDatabase::Index section);
+
+			/**
+			 * Parses all remaining sections.
+			 *
+			 * @return the complete database.
+			 */
+			rpg::Database& GetAll();
+
+			/** @return whether the section is present in the file. */
+			bool Has(ChunkDatabase::Index section) const;
+
+			/** @return whether the section was parsed already. */
+			bool IsLoaded(ChunkDatabase::Index section) const;
+
+		private:
+			struct Chunk {
+				uint32_t offset = 0;
+				uint32_t length = 0;
+			};
+			struct Section {
+				/** Every occurrence of the chunk, in file order */
+				std::vector<Chunk> chunks;
+				bool loaded = false;
+			};
+
+			LazyDatabase();
+			static std::unique_ptr<LazyDatabase> Open(std::unique_ptr<LcfReader> reader);
+
+			rpg::Database _db;
+			std::unique_ptr<MappedFile> _file;
+			std::unique_ptr<LcfReader> _reader;
+			std::vector<Section> _sections;
+
+			friend std::unique_ptr<LazyDatabase> LoadLazy(std::string_view, std::string_view);
+			friend std::unique_ptr<LazyDatabase> LoadLazy(Span<const uint8_t>, std::string_view);
+	};
+
 	/**
 	 * Increment the database save_count.
 	 */
@@ -32,6 +96,18 @@ namespace LDB_Reader {
 	 */
 	std::unique_ptr<lcf::rpg::Database> Load(std::string_view filename, std::string_view encoding = "");
 
+	/**
+	 * Loads Database through a cache in cache_dir.
+	 *
+	 * When the cache was made from the same file contents and encoding the
+	 * cache is loaded without transcoding any string. Otherwise the file is
+	 * parsed and the cache is written. Caches are named after the file and
+	 * a hash of its path and the encoding, so games can share a cache_dir.
+	 *
+	 * @param cache_dir existing directory, when empty no cache is used.
+	 */
+	std::unique_ptr<lcf::rpg::Database> Load(std::string_view filename, std::string_view encoding, std::string_view cache_dir);
+
 	/**
 	 * Saves Database.
 	 */
@@ -39,8 +115,9 @@ namespace LDB_Reader {
 
 	/**
 	 * Saves Database as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::string_view filename, const lcf::rpg::Database& db);
+	bool SaveXml(std::string_view filename, const lcf::rpg::Database& db, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Load Database as XML.
@@ -52,20 +129,100 @@ namespace LDB_Reader {
 	 */
 	std::unique_ptr<lcf::rpg::Database> Load(std::istream& filestream, std::string_view encoding = "");
 
+	/**
+	 * Loads Database from a memory buffer.
+	 * The buffer is only accessed during the call.
+	 */
+	std::unique_ptr<lcf::rpg::Database> Load(Span<const uint8_t> buffer, std::string_view encoding = "");
+
+	/**
+	 * Walks the chunks of a Database file without loading it, see ChunkVisitor.
+	 * The file is memory mapped.
+	 *
+	 * @return false when the file is not a valid database or is corrupted.
+	 */
+	bool Visit(std::string_view filename, ChunkVisitor& visitor);
+
+	/**
+	 * Walks the chunks of a Database in a memory buffer, see ChunkVisitor.
+	 *
+	 * @return false when the buffer is not a valid database or is corrupted.
+	 */
+	bool Visit(Span<const uint8_t> buffer, ChunkVisitor& visitor);
+
+	/**
+	 * Reads the event commands of all common events into compact lists,
+	 * without loading the rest of the database. The file is memory mapped.
+	 *
+	 * @return one list per common event in the order of
+	 *         Database::commonevents, empty on failure.
+	 */
+	std::vector<EventCommandList> LoadEventCommands(std::string_view filename, std::string_view encoding = "");
+
+	/**
+	 * Reads the event commands of all common events in a memory buffer
+	 * into compact lists, see LoadEventCommands.
+	 */
+	std::vector<EventCommandList> LoadEventCommands(Span<const uint8_t> buffer, std::string_view encoding = "");
+
+	/**
+	 * Loads Database, parsing the top-level sections on multiple threads.
+	 * Messages of the worker threads reach the log handler on the calling
+	 * thread after parsing.
+	 *
+	 * @param threads number of threads, 0 uses the hardware concurrency.
+	 */
+	std::unique_ptr<lcf::rpg::Database> LoadParallel(std::string_view filename, std::string_view encoding = "", unsigned threads = 0);
+
+	/**
+	 * Loads Database from a memory buffer, parsing the top-level sections
+	 * on multiple threads.
+	 *
+	 * @param threads number of threads, 0 uses the hardware concurrency.
+	 */
+	std::unique_ptr<lcf::rpg::Database> LoadParallel(Span<const uint8_t> buffer, std::string_view encoding = "", unsigned threads = 0);
+
+	/**
+	 * Opens Database for parsing its sections on demand.
+	 * The file stays mapped until the returned object is destroyed.
+	 */
+	std::unique_ptr<LazyDatabase> LoadLazy(std::string_view filename, std::string_view encoding = "");
+
+	/**
+	 * Opens Database in a memory buffer for parsing its sections on demand.
+	 * The buffer must stay valid until the returned object is destroyed.
+	 */
+	std::unique_ptr<LazyDatabase> LoadLazy(Span<const uint8_t> buffer, std::string_view encoding = "");
+
 	/**
 	 * Saves Database.
 	 */
 	bool Save(std::ostream& filestream, const lcf::rpg::Database& db, std::string_view encoding = "", SaveOpt opt = SaveOpt::eNone);
 
+	/**
+	 * Saves Database into memory.
+	 *
+	 * @return the file contents or an empty buffer on failure.
+	 */
+	std::vector<uint8_t> SaveToBuffer(const lcf::rpg::Database& db, std::string_view encoding = "", SaveOpt opt = SaveOpt::eNone);
+
 	/**
 	 * Saves Database as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::ostream& filestream, const lcf::rpg::Database& db);
+	bool SaveXml(std::ostream& filestream, const lcf::rpg::Database& db, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Load Database as XML.
 	 */
 	std::unique_ptr<lcf::rpg::Database> LoadXml(std::istream& filestream);
+
+	/**
+	 * Loads Database as XML from a memory buffer.
+	 * The whole document is parsed at once, the buffer is only accessed
+	 * during the call.
+	 */
+	std::unique_ptr<lcf::rpg::Database> LoadXml(Span<const uint8_t> buffer);
 }
 
 } // namespace lcf
@@ -11,9 +11,11 @@
 #define LCF_LMT_READER_H
 
 #include <string>
+#include <vector>
 #include <memory>
 #include "lcf/rpg/treemap.h"
 #include "lcf/saveopt.h"
+#include "lcf/span.h"
 
 namespace lcf {
 
@@ -34,8 +36,9 @@ namespace LMT_Reader {
 
 	/**
 	 * Saves Map Tree as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::string_view filename, const lcf::rpg::TreeMap& tmap, EngineVersion engine);
+	bool SaveXml(std::string_view filename, const lcf::rpg::TreeMap& tmap, EngineVersion engine, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Loads Map Tree as XML.
@@ -47,20 +50,41 @@ namespace LMT_Reader {
 	 */
 	std::unique_ptr<lcf::rpg::TreeMap> Load(std::istream& filestream, std::string_view encoding = "");
 
+	/**
+	 * Loads Map Tree from a memory buffer.
+	 * The buffer is only accessed during the call.
+	 */
+	std::unique_ptr<lcf::rpg::TreeMap> Load(Span<const uint8_t> buffer, std::string_view encoding = "");
+
 	/**
 	 * Saves Map Tree.
 	 */
 	bool Save(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, EngineVersion engine, std::string_view encoding = "", SaveOpt opt = SaveOpt::eNone);
 
+	/**
+	 * Saves Map Tree into memory.
+	 *
+	 * @return the file contents or an empty buffer on failure.
+	 */
+	std::vector<uint8_t> SaveToBuffer(const lcf::rpg::TreeMap& tmap, EngineVersion engine, std::string_view encoding = "", SaveOpt opt = SaveOpt::eNone);
+
 	/**
 	 * Saves Map Tree as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, EngineVersion engine);
+	bool SaveXml(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, EngineVersion engine, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Loads Map Tree as XML.
 	 */
 	std::unique_ptr<lcf::rpg::TreeMap> LoadXml(std::istream& filestream);
+
+	/**
+	 * Loads Map Tree as XML from a memory buffer.
+	 * The whole document is parsed at once, the buffer is only accessed
+	 * during the call.
+	 */
+	std::unique_ptr<lcf::rpg::TreeMap> LoadXml(Span<const uint8_t> buffer);
 }
 
 } //namespace lcf
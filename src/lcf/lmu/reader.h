@@ -11,9 +11,13 @@
 #define LCF_LMU_READER_H
 
 #include <string>
+#include <vector>
 #include <memory>
 #include "lcf/rpg/map.h"
+#include "lcf/chunk_visitor.h"
+#include "lcf/event_command_list.h"
 #include "lcf/saveopt.h"
+#include "lcf/span.h"
 
 namespace lcf {
 
@@ -32,6 +36,18 @@ namespace LMU_Reader {
 	 */
 	std::unique_ptr<rpg::Map> Load(std::string_view filename, std::string_view encoding = "");
 
+	/**
+	 * Loads map through a cache in cache_dir.
+	 *
+	 * When the cache was made from the same file contents and encoding the
+	 * cache is loaded without transcoding any string. Otherwise the file is
+	 * parsed and the cache is written. Caches are named after the file and
+	 * a hash of its path and the encoding, so games can share a cache_dir.
+	 *
+	 * @param cache_dir existing directory, when empty no cache is used.
+	 */
+	std::unique_ptr<rpg::Map> Load(std::string_view filename, std::string_view encoding, std::string_view cache_dir);
+
 	/**
 	 * Saves map.
 	 */
@@ -39,8 +55,9 @@ namespace LMU_Reader {
 
 	/**
 	 * Saves map as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::string_view filename, const rpg::Map& map, EngineVersion engine);
+	bool SaveXml(std::string_view filename, const rpg::Map& map, EngineVersion engine, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Loads map as XML.
@@ -52,20 +69,71 @@ namespace LMU_Reader {
 	 */
 	std::unique_ptr<rpg::Map> Load(std::istream& filestream, std::string_view encoding = "");
 
+	/**
+	 * Loads map from a memory buffer.
+	 * The buffer is only accessed during the call.
+	 */
+	std::unique_ptr<rpg::Map> Load(Span<const uint8_t> buffer, std::string_view encoding = "");
+
+	/**
+	 * Walks the chunks of a map file without loading it, see ChunkVisitor.
+	 * The file is memory mapped.
+	 *
+	 * @return false when the file is not a valid map or is corrupted.
+	 */
+	bool Visit(std::string_view filename, ChunkVisitor& visitor);
+
+	/**
+	 * Walks the chunks of a map in a memory buffer, see ChunkVisitor.
+	 *
+	 * @return false when the buffer is not a valid map or is corrupted.
+	 */
+	bool Visit(Span<const uint8_t> buffer, ChunkVisitor& visitor);
+
+	/**
+	 * Reads the event commands of all event pages into compact lists,
+	 * without loading the rest of the map. The file is memory mapped.
+	 *
+	 * @return for every event one list per page, in the order of
+	 *         Map::events and Event::pages, empty on failure.
+	 */
+	std::vector<std::vector<EventCommandList>> LoadEventCommands(std::string_view filename, std::string_view encoding = "");
+
+	/**
+	 * Reads the event commands of all event pages in a memory buffer
+	 * into compact lists, see LoadEventCommands.
+	 */
+	std::vector<std::vector<EventCommandList>> LoadEventCommands(Span<const uint8_t> buffer, std::string_view encoding = "");
+
 	/**
 	 * Saves map.
 	 */
 	bool Save(std::ostream& filestream, const rpg::Map& map, EngineVersion engine, std::string_view encoding = "", SaveOpt opt = SaveOpt::eNone);
 
+	/**
+	 * Saves map into memory.
+	 *
+	 * @return the file contents or an empty buffer on failure.
+	 */
+	std::vector<uint8_t> SaveToBuffer(const rpg::Map& map, EngineVersion engine, std::string_view encoding = "", SaveOpt opt = SaveOpt::eNone);
+
 	/**
 	 * Saves map as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::ostream& filestream, const rpg::Map& map, EngineVersion engine);
+	bool SaveXml(std::ostream& filestream, const rpg::Map& map, EngineVersion engine, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Loads map as XML.
 	 */
 	std::unique_ptr<rpg::Map> LoadXml(std::istream& filestream);
+
+	/**
+	 * Loads map as XML from a memory buffer.
+	 * The whole document is parsed at once, the buffer is only accessed
+	 * during the call.
+	 */
+	std::unique_ptr<rpg::Map> LoadXml(Span<const uint8_t> buffer);
 }
 
 } //namespace lcf
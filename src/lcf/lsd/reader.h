@@ -16,7 +16,9 @@
 #include <ctime>
 #include <stdint.h>
 #include "lcf/rpg/save.h"
+#include "lcf/chunk_visitor.h"
 #include "lcf/saveopt.h"
+#include "lcf/span.h"
 
 namespace lcf {
 
@@ -56,8 +58,9 @@ namespace LSD_Reader {
 
 	/*
 	 * Saves Savegame as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::string_view filename, const rpg::Save& save, EngineVersion engine);
+	bool SaveXml(std::string_view filename, const rpg::Save& save, EngineVersion engine, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Loads Savegame as XML.
@@ -69,20 +72,56 @@ namespace LSD_Reader {
 	 */
 	std::unique_ptr<rpg::Save> Load(std::istream& filestream, std::string_view encoding = "");
 
+	/**
+	 * Loads Savegame from a memory buffer.
+	 * The buffer is only accessed during the call.
+	 */
+	std::unique_ptr<rpg::Save> Load(Span<const uint8_t> buffer, std::string_view encoding = "");
+
+	/**
+	 * Walks the chunks of a Savegame file without loading it, see ChunkVisitor.
+	 * The file is memory mapped.
+	 *
+	 * @return false when the file is not a valid save or is corrupted.
+	 */
+	bool Visit(std::string_view filename, ChunkVisitor& visitor);
+
+	/**
+	 * Walks the chunks of a Savegame in a memory buffer, see ChunkVisitor.
+	 *
+	 * @return false when the buffer is not a valid save or is corrupted.
+	 */
+	bool Visit(Span<const uint8_t> buffer, ChunkVisitor& visitor);
+
 	/**
 	 * Saves Savegame.
 	 */
 	bool Save(std::ostream& filestream, const rpg::Save& save, EngineVersion engine, std::string_view encoding = "");
 
+	/**
+	 * Saves Savegame into memory.
+	 *
+	 * @return the file contents or an empty buffer on failure.
+	 */
+	std::vector<uint8_t> SaveToBuffer(const rpg::Save& save, EngineVersion engine, std::string_view encoding = "");
+
 	/*
 	 * Saves Savegame as XML.
+	 * SaveOpt::eCompactXml omits the indentation.
 	 */
-	bool SaveXml(std::ostream& filestream, const rpg::Save& save, EngineVersion engine);
+	bool SaveXml(std::ostream& filestream, const rpg::Save& save, EngineVersion engine, SaveOpt opt = SaveOpt::eNone);
 
 	/**
 	 * Loads Savegame as XML.
 	 */
 	std::unique_ptr<rpg::Save> LoadXml(std::istream& filestream);
+
+	/**
+	 * Loads Savegame as XML from a memory buffer.
+	 * The whole document is parsed at once, the buffer is only accessed
+	 * during the call.
+	 */
+	std::unique_ptr<rpg::Save> LoadXml(Span<const uint8_t> buffer);
 }
 
 } //namespace lcf
@@ -24,6 +24,7 @@
 #include <memory>
 #include "lcf/reader_util.h"
 #include "lcf/encoder.h"
+#include "lcf/span.h"
 
 namespace lcf {
 
@@ -40,6 +41,16 @@ public:
 	 */
 	explicit LcfReader(std::istream& filestream, std::string encoding = "");
 
+	/**
+	 * Constructs a new Reader over a memory buffer.
+	 * All reads are bounds checked against the buffer and the
+	 * buffer must stay valid while the reader is in use.
+	 *
+	 * @param buffer contents of the file.
+	 * @param encoding name of the encoding.
+	 */
+	explicit LcfReader(Span<const uint8_t> buffer, std::string encoding = "");
+
 	/**
 	 * Returns the last set error.
 	 *
@@ -129,6 +140,15 @@ public:
 	 */
 	int ReadInt();
 
+	/**
+	 * Reads multiple compressed integers from the stream.
+	 * Faster than calling ReadInt in a loop when reading from memory.
+	 *
+	 * @param values array to store the decompressed integers.
+	 * @param count number of integers to read.
+	 */
+	void ReadInts(int32_t* values, size_t count);
+
 	/**
 	 * Reads a compressed 64bit unsigned integer from the stream.
 	 *
@@ -160,6 +180,12 @@ public:
 	 */
 	bool Eof() const;
 
+	/**
+	 * Resets the end of file and error state after a failed read.
+	 * Seeking does not reset it, same as the failbit of a stream.
+	 */
+	void Clear();
+
 	/**
 	 * Moves the read pointer to a different position in
 	 * the stream.
@@ -226,9 +252,23 @@ public:
 	std::string& StrBuffer();
 
 private:
-	/** File-stream managed by this Reader. */
-	std::istream& stream;
-	/** Cached file stream offset */
+	/**
+	 * Consumes size bytes without copying them when reading from memory.
+	 * Otherwise they are read into StrBuffer, missing bytes are zero.
+	 *
+	 * @return pointer to the bytes, valid until the next read.
+	 */
+	const char* ReadView(size_t size);
+
+	/** File-stream managed by this Reader or nullptr when reading from memory. */
+	std::istream* stream = nullptr;
+	/** Start of the memory buffer when reading from memory. */
+	const uint8_t* data = nullptr;
+	/** Size of the memory buffer. */
+	size_t data_size = 0;
+	/** Set when reading from memory failed due to end of buffer, until Clear(). */
+	bool data_eof = false;
+	/** Cached file stream offset or offset in the memory buffer */
 	int64_t offset;
 	/** Contains the last set error. */
 	static std::string error_str;
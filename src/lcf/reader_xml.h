@@ -12,9 +12,11 @@
 
 #include "lcf/config.h"
 #include "lcf/dbarray.h"
+#include "lcf/span.h"
 
 #include <string>
 #include <vector>
+#include <cstddef>
 #include <cstdio>
 #if LCF_SUPPORT_XML
 #  include <expat.h>
@@ -35,12 +37,25 @@ class XmlHandler;
 class XmlReader {
 
 public:
+	/** Default size of the slices read from streams. */
+	static constexpr size_t default_chunk_size = 65536;
+
 	/**
 	 * Constructs a new File Reader.
 	 *
 	 * @param filestream already opened filestream.
+	 * @param chunk_size size of the slices read from the stream and
+	 *                   passed to the parser.
+	 */
+	XmlReader(std::istream& filestream, size_t chunk_size = default_chunk_size);
+
+	/**
+	 * Constructs a new Reader of a whole document in memory.
+	 * The document is parsed in one pass without copying it.
+	 *
+	 * @param buffer XML document, must stay valid until Parse returns.
 	 */
-	XmlReader(std::istream& filestream);
+	explicit XmlReader(Span<const uint8_t> buffer);
 
 	/**
 	 * Destructor. Closes the opened file.
@@ -98,8 +113,15 @@ public:
 	void EndElement(const char* name);
 
 protected:
-	/** File-stream managed by this Reader. */
-	std::istream& stream;
+	/** Creates the parser. */
+	void Init();
+
+	/** File-stream managed by this Reader, NULL for memory documents. */
+	std::istream* stream = nullptr;
+	/** Memory document. */
+	Span<const uint8_t> data;
+	/** Size of the slices read from stream. */
+	size_t chunk_size = default_chunk_size;
 	/** Expat XML parser object. */
 #if LCF_SUPPORT_XML
 	XML_Parser parser;
@@ -127,6 +149,13 @@ public:
 	XmlHandler() {}
 	virtual ~XmlHandler() {}
 
+	/**
+	 * A handler is created for most elements, the memory of deleted
+	 * handlers is kept in a per thread free list and reused.
+	 */
+	static void* operator new(std::size_t size);
+	static void operator delete(void* ptr, std::size_t size) noexcept;
+
 };
 
 } //namespace lcf
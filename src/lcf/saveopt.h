@@ -16,11 +16,14 @@ class Database;
 };
 
 /**
- * Options to configure how LDB file is saved
+ * Options to configure how files are saved
  */
 enum class SaveOpt {
 	eNone = 0,
-	ePreserveHeader = 1
+	/** Keep the header of the loaded LDB file */
+	ePreserveHeader = 1,
+	/** Write XML without indentation */
+	eCompactXml = 2
 };
 
 constexpr SaveOpt operator|(SaveOpt l, SaveOpt r) { return SaveOpt(int(l) | int(r)); }
@@ -15,6 +15,7 @@
 #include "lcf/dbstring.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <iosfwd>
 #include <cstring>
@@ -27,6 +28,12 @@
 
 namespace lcf {
 
+namespace rpg {
+	class EventCommand;
+	class MoveCommand;
+}
+template <class T> struct RawStruct;
+
 /**
  * LcfWriter class.
  */
@@ -42,6 +49,21 @@ public:
 	 */
 	LcfWriter(std::ostream& filestream, EngineVersion engine, std::string encoding = "");
 
+	/**
+	 * Constructs a new Writer which only collects the data in memory.
+	 * The data is retrieved with TakeBuffer.
+	 *
+	 * @param engine Which format to write.
+	 * @param encoding name of the encoding.
+	 */
+	LcfWriter(EngineVersion engine, std::string encoding = "");
+
+	/** Flushes remaining data to the stream. */
+	~LcfWriter();
+
+	LcfWriter(const LcfWriter&) = delete;
+	LcfWriter& operator=(const LcfWriter&) = delete;
+
 	/**
 	 * Writes raw data to the stream (fwrite() wrapper).
 	 *
@@ -97,9 +119,42 @@ public:
 	template <class T>
 	void Write(const std::vector<T>& buffer);
 
+	/**
+	 * Starts the data of a chunk whose length is not known yet.
+	 * Everything written until the matching EndChunk is buffered. The
+	 * compressed lengths of a top-level chunk and all chunks nested in
+	 * it are inserted in one pass when it ends, so every chunk is
+	 * serialized once without calculating its size beforehand and
+	 * every byte is moved at most once.
+	 *
+	 * @return handle to pass to EndChunk.
+	 */
+	size_t BeginChunk();
+
+	/**
+	 * Ends the chunk started by BeginChunk and writes its length.
+	 *
+	 * @param chunk handle returned by BeginChunk.
+	 */
+	void EndChunk(size_t chunk);
+
+	/**
+	 * Writes the buffered data to the stream with a single write.
+	 * All data is buffered until this is called or the Writer is
+	 * destroyed. Must not be called while a chunk is open.
+	 */
+	void Flush();
+
+	/**
+	 * Takes the buffered data out of the Writer.
+	 *
+	 * @return data written since the last Flush.
+	 */
+	std::vector<uint8_t> TakeBuffer();
+
 	/**
 	 * Returns the current position of the read pointer in
-	 * the stream.
+	 * the stream. The lengths of open chunks count as one byte.
 	 *
 	 * @return current location in the stream.
 	 */
@@ -121,16 +176,102 @@ public:
 	 */
 	std::string Decode(std::string_view str_to_encode);
 
+	/**
+	 * Decodes a string like Decode into a buffer of the Writer.
+	 *
+	 * @param str_to_encode UTF-8 string to encode.
+	 * @return native version of string. Valid until the next call.
+	 */
+	std::string_view DecodeBuffered(std::string_view str_to_encode);
+
 	/** @return true if 2k3 format, false if 2k format */
 	bool Is2k3() const;
 
+	/**
+	 * Also writes the 2k3 only fields when writing the 2k format.
+	 * Default values are still compared against the 2k defaults,
+	 * a reader of the 2k format gets the same result as from the
+	 * original file.
+	 *
+	 * @param keep true to write the 2k3 only fields.
+	 */
+	void SetKeep2k3Fields(bool keep);
+
+	/** @return true if 2k3 only fields are written */
+	bool Writes2k3Fields() const;
+
 private:
-	/** File-stream managed by this Writer. */
-	std::ostream& stream;
+	/** Event and move command strings are sized before they are written */
+	friend struct RawStruct<rpg::EventCommand>;
+	friend struct RawStruct<rpg::MoveCommand>;
+
+	/**
+	 * Decodes a string like Decode but converts it only once per
+	 * top-level chunk. For strings that are decoded twice, e.g. sized
+	 * by LcfSize before they are written. The result is cached by the
+	 * address and size of the string, which must not change until the
+	 * end of the top-level chunk. Strings that need no conversion are
+	 * returned as is.
+	 *
+	 * @param str_to_encode UTF-8 string to encode.
+	 * @return native version of string. Valid until the end of the
+	 *         current top-level chunk.
+	 */
+	std::string_view DecodeCached(std::string_view str_to_encode);
+
+	/** File-stream managed by this Writer, NULL when writing to memory only. */
+	std::ostream* stream = nullptr;
+	/** Position of the stream where the buffer starts */
+	uint32_t stream_pos = 0;
 	/** Encoder object */
 	Encoder encoder;
 	/** Writing 2k3 format */
 	EngineVersion engine;
+	/** Write 2k3 only fields in the 2k format */
+	bool keep_2k3_fields = false;
+	/** Data not flushed yet */
+	std::vector<uint8_t> buffer;
+
+	struct ChunkFixup {
+		/** Buffer position of the chunk data, the length goes in front */
+		size_t pos = 0;
+		/** Length bytes of the closed chunks nested in this one */
+		size_t nested = 0;
+		/** Compressed length, set by EndChunk */
+		uint8_t length[5] = {};
+		uint8_t length_size = 0;
+	};
+	/** Chunks of the current top-level chunk in the order they started */
+	std::vector<ChunkFixup> chunk_fixups;
+	/** Indices into chunk_fixups of the open chunks, innermost last */
+	std::vector<size_t> open_chunks;
+
+	/** Result of DecodeBuffered */
+	std::string decode_buffer;
+
+	/** Address and size of a string converted by DecodeCached */
+	struct DecodeKey {
+		const char* data;
+		size_t size;
+		bool operator==(const DecodeKey& o) const { return data == o.data && size == o.size; }
+	};
+	struct DecodeKeyHash {
+		size_t operator()(const DecodeKey& key) const {
+			return std::hash<const char*>()(key.data) ^ key.size;
+		}
+	};
+	/** Native versions of the strings converted by DecodeCached */
+	std::unordered_map<DecodeKey, std::string, DecodeKeyHash> decode_cache;
+
+	/**
+	 * Grows the buffer.
+	 *
+	 * @return pointer to the size added bytes.
+	 */
+	uint8_t* Append(size_t size);
+
+	/** Inserts the lengths of chunk_fixups into the buffer. */
+	void InsertChunkLengths();
 
 	/**
 	 * Converts a 16bit signed integer to/from little-endian.
@@ -173,6 +314,14 @@ inline bool LcfWriter::Is2k3() const {
 	return engine == EngineVersion::e2k3;
 }
 
+inline void LcfWriter::SetKeep2k3Fields(bool keep) {
+	keep_2k3_fields = keep;
+}
+
+inline bool LcfWriter::Writes2k3Fields() const {
+	return keep_2k3_fields || Is2k3();
+}
+
 } //namespace lcf
 
 #endif
@@ -32,8 +32,9 @@ public:
 	 *
 	 * @param filestream already opened filestream.
 	 * @param engine Which engine format to write.
+	 * @param compact Don't indent the elements.
 	 */
-	XmlWriter(std::ostream& filestream, EngineVersion engine);
+	XmlWriter(std::ostream& filestream, EngineVersion engine, bool compact = false);
 
 	/**
 	 * Destructor. Closes the opened file.
@@ -45,6 +46,11 @@ public:
 	 */
 	void Close();
 
+	/**
+	 * Writes the buffered output to the stream.
+	 */
+	void Flush();
+
 	/**
 	 * Writes an integer to the stream.
 	 *
@@ -111,10 +117,14 @@ public:
 protected:
 	/** File-stream managed by this Writer. */
 	std::ostream& stream;
+	/** Output not written to the stream yet. */
+	std::string buffer;
 	/** Stores indentation level. */
 	int indent;
 	/** Indicates if writer cursor is at the beginning of the line. */
 	bool at_bol;
+	/** Don't indent the elements. */
+	bool compact;
 	/** Writing which engine format */
 	EngineVersion engine;
 
@@ -0,0 +1,200 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#  include <process.h>
+#  define LCF_GETPID _getpid
+#elif __has_include(<unistd.h>)
+#  include <unistd.h>
+#  define LCF_GETPID getpid
+#endif
+
+#include "lcf_cache.h"
+#include "lcf/config.h"
+#include "log.h"
+
+namespace lcf {
+
+namespace {
+
+constexpr char magic[8] = { 'L', 'c', 'f', 'C', 'a', 'c', 'h', 'e' };
+/** Bumped when the layout of the header changes */
+constexpr uint32_t format_version = 1;
+constexpr size_t version_size = 16;
+constexpr size_t encoding_size = 32;
+
+/*
+ * Header, all integers are little endian:
+ * magic[8] format_version:u32 kind:u32 hash:u64 payload_size:u64
+ * version[16] encoding[32], strings are zero padded
+ */
+constexpr size_t header_size = sizeof(magic) + 4 + 4 + 8 + 8 + version_size + encoding_size;
+
+uint64_t LoadLE(const uint8_t* p, size_t n) {
+	uint64_t v = 0;
+	for (size_t i = 0; i < n; ++i) {
+		v |= uint64_t(p[i]) << (i * 8);
+	}
+	return v;
+}
+
+void StoreLE(uint8_t* p, uint64_t v, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		p[i] = static_cast<uint8_t>(v >> (i * 8));
+	}
+}
+
+/** Stores a zero padded string, returns false when it does not fit */
+bool StoreString(uint8_t* p, std::string_view str, size_t n) {
+	if (str.size() >= n) {
+		return false;
+	}
+	std::memset(p, 0, n);
+	std::memcpy(p, str.data(), str.size());
+	return true;
+}
+
+bool MatchString(const uint8_t* p, std::string_view str, size_t n) {
+	return str.size() < n
+		&& std::memcmp(p, str.data(), str.size()) == 0
+		&& p[str.size()] == 0;
+}
+
+/** Name for the temporary file, unique per process and call */
+std::string GetTempPath(const std::string& path) {
+	static std::atomic<uint32_t> counter{0};
+	std::string tmp = path;
+	tmp += '.';
+#ifdef LCF_GETPID
+	tmp += std::to_string(LCF_GETPID());
+	tmp += '.';
+#endif
+	tmp += std::to_string(counter++);
+	tmp += ".tmp";
+	return tmp;
+}
+
+} // namespace
+
+uint64_t LcfCache::Hash(Span<const uint8_t> data) {
+	// Word-wise multiply and fold, fast enough to not matter next to parsing
+	constexpr uint64_t mul = UINT64_C(0x9E3779B97F4A7C15);
+	const auto* p = data.data();
+	const size_t size = data.size();
+	uint64_t h = UINT64_C(0xCBF29CE484222325) ^ size;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		h = (h ^ LoadLE(p + i, 8)) * mul;
+		h ^= h >> 32;
+	}
+	h = (h ^ LoadLE(p + i, size - i)) * mul;
+	h ^= h >> 29;
+	return h;
+}
+
+std::string LcfCache::GetPath(std::string_view cache_dir, std::string_view filename, std::string_view encoding) {
+	const auto slash = filename.find_last_of("/\\");
+	const auto base = slash == std::string_view::npos ? filename : filename.substr(slash + 1);
+
+	// Files of the same name from other directories or loaded with another
+	// encoding get their own cache
+	std::string key(filename);
+	key += '\0';
+	key.append(encoding.data(), encoding.size());
+	char key_hash[17];
+	snprintf(key_hash, sizeof(key_hash), "%016" PRIx64,
+			Hash(Span<const uint8_t>(reinterpret_cast<const uint8_t*>(key.data()), key.size())));
+
+	std::string path(cache_dir);
+	if (!path.empty() && path.back() != '/' && path.back() != '\\') {
+		path += '/';
+	}
+	path.append(base.data(), base.size());
+	path += '.';
+	path += key_hash;
+	path += ".lcfcache";
+	return path;
+}
+
+Span<const uint8_t> LcfCache::GetPayload(Span<const uint8_t> cache, Kind kind, uint64_t hash, std::string_view encoding) {
+	if (cache.size() < header_size) {
+		return {};
+	}
+
+	const auto* p = cache.data();
+	if (std::memcmp(p, magic, sizeof(magic)) != 0) {
+		return {};
+	}
+	p += sizeof(magic);
+	if (LoadLE(p, 4) != format_version || LoadLE(p + 4, 4) != static_cast<uint32_t>(kind) || LoadLE(p + 8, 8) != hash) {
+		return {};
+	}
+	const auto payload_size = LoadLE(p + 16, 8);
+	p += 24;
+	if (!MatchString(p, LCF_VERSION, version_size) || !MatchString(p + version_size, encoding, encoding_size)) {
+		return {};
+	}
+	if (payload_size != cache.size() - header_size) {
+		// Truncated
+		return {};
+	}
+	return cache.subspan(header_size);
+}
+
+void LcfCache::Write(std::string_view path, Kind kind, uint64_t hash, std::string_view encoding, Span<const uint8_t> payload) {
+	uint8_t header[header_size];
+	std::memcpy(header, magic, sizeof(magic));
+	auto* p = header + sizeof(magic);
+	StoreLE(p, format_version, 4);
+	StoreLE(p + 4, static_cast<uint32_t>(kind), 4);
+	StoreLE(p + 8, hash, 8);
+	StoreLE(p + 16, payload.size(), 8);
+	p += 24;
+	if (!StoreString(p, LCF_VERSION, version_size) || !StoreString(p + version_size, encoding, encoding_size)) {
+		Log::Debug("Not caching '%s': encoding name too long", ToString(path).c_str());
+		return;
+	}
+
+	// Write to a temporary file first, readers never see a partial cache
+	const auto final_path = ToString(path);
+	const auto tmp_path = GetTempPath(final_path);
+	{
+		std::ofstream stream(tmp_path, std::ios::binary);
+		if (!stream.is_open()) {
+			Log::Warning("Failed to open cache file '%s' for writing: %s", tmp_path.c_str(), strerror(errno));
+			return;
+		}
+		stream.write(reinterpret_cast<const char*>(header), header_size);
+		stream.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+		if (!stream) {
+			Log::Warning("Failed to write cache file '%s'", tmp_path.c_str());
+			stream.close();
+			std::remove(tmp_path.c_str());
+			return;
+		}
+	}
+#ifdef _WIN32
+	// rename does not replace existing files
+	std::remove(final_path.c_str());
+#endif
+	if (std::rename(tmp_path.c_str(), final_path.c_str()) != 0) {
+		Log::Warning("Failed to rename cache file '%s': %s", tmp_path.c_str(), strerror(errno));
+		std::remove(tmp_path.c_str());
+	}
+}
+
+} // namespace lcf
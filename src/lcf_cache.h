@@ -0,0 +1,61 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_LCF_CACHE_H
+#define LCF_LCF_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include "lcf/span.h"
+#include "lcf/string_view.h"
+
+namespace lcf {
+
+/**
+ * Cache files (.lcfcache) of parsed LCF files.
+ *
+ * A cache holds the file saved again with UTF-8 strings, so loading it
+ * skips all transcoding. The header stores a hash of the source file, the
+ * source encoding and the liblcf version, a cache is only used when all of
+ * them match.
+ */
+namespace LcfCache {
+	enum class Kind : uint32_t {
+		Database = 1,
+		Map = 2
+	};
+
+	/** @return hash of the file contents used to validate caches */
+	uint64_t Hash(Span<const uint8_t> data);
+
+	/**
+	 * @return path of the cache of filename in cache_dir. The name contains
+	 *         a hash of filename and encoding, so files of the same name
+	 *         from different games can share cache_dir.
+	 */
+	std::string GetPath(std::string_view cache_dir, std::string_view filename, std::string_view encoding);
+
+	/**
+	 * Validates the header of a cache file.
+	 *
+	 * @return the UTF-8 LCF data of the cache or an empty span when the
+	 *         cache does not match.
+	 */
+	Span<const uint8_t> GetPayload(Span<const uint8_t> cache, Kind kind, uint64_t hash, std::string_view encoding);
+
+	/**
+	 * Writes a cache file. The file is replaced atomically where possible,
+	 * failures are logged and otherwise ignored.
+	 */
+	void Write(std::string_view path, Kind kind, uint64_t hash, std::string_view encoding, Span<const uint8_t> payload);
+}
+
+} // namespace lcf
+
+#endif
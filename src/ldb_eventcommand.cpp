@@ -11,6 +11,7 @@
 #include <vector>
 #include "log.h"
 #include "reader_struct.h"
+#include "lcf/event_command_list.h"
 #include "lcf/rpg/eventcommand.h"
 
 namespace lcf {
@@ -33,23 +34,36 @@ struct RawStruct<std::vector<rpg::EventCommand> > {
 	static void BeginXml(std::vector<rpg::EventCommand>& ref, XmlReader& stream);
 };
 
+/**
+ * Limits a parameter count read from the file to the bytes left before
+ * endpos. Every parameter takes at least one byte, so corrupted counts
+ * cannot make the reader allocate more than the file holds.
+ */
+static int ClampParameterCount(LcfReader& stream, int count, uint32_t endpos) {
+	const uint32_t pos = stream.Tell();
+	const uint32_t left = pos < endpos ? endpos - pos : 0;
+	if (count > 0 && static_cast<uint32_t>(count) > left) {
+		Log::Warning("Event command parameter count %d exceeds the data at %" PRIu32 "", count, pos);
+		return static_cast<int>(left);
+	}
+	return count;
+}
+
 /**
  * Reads Event Command.
+ * length is the number of bytes left in the command list.
  */
-void RawStruct<rpg::EventCommand>::ReadLcf(rpg::EventCommand& event_command, LcfReader& stream, uint32_t /* length */) {
+void RawStruct<rpg::EventCommand>::ReadLcf(rpg::EventCommand& event_command, LcfReader& stream, uint32_t length) {
+	const uint32_t endpos = stream.Tell() + length;
 	stream.Read(event_command.code);
 	if (event_command.code != 0) {
 		stream.Read(event_command.indent);
 		stream.ReadString(event_command.string, stream.ReadInt());
 
-		auto& param_buf = stream.IntBuffer();
-
-		param_buf.clear();
-		for (int i = stream.ReadInt(); i > 0; i--) {
-			param_buf.push_back(stream.ReadInt());
-		}
-		if (!param_buf.empty()) {
-			event_command.parameters = DBArray<int32_t>(param_buf.begin(), param_buf.end());
+		int count = ClampParameterCount(stream, stream.ReadInt(), endpos);
+		if (count > 0) {
+			event_command.parameters = DBArray<int32_t>(count);
+			stream.ReadInts(event_command.parameters.data(), count);
 		}
 	}
 }
@@ -57,8 +71,9 @@ void RawStruct<rpg::EventCommand>::ReadLcf(rpg::EventCommand& event_command, Lcf
 void RawStruct<rpg::EventCommand>::WriteLcf(const rpg::EventCommand& event_command, LcfWriter& stream) {
 	stream.Write(event_command.code);
 	stream.Write(event_command.indent);
-	stream.WriteInt(stream.Decode(event_command.string).size());
-	stream.Write(event_command.string);
+	auto str = stream.DecodeCached(event_command.string);
+	stream.WriteInt(str.size());
+	stream.Write(str.data(), 1, str.size());
 	int32_t count = (int32_t)event_command.parameters.size();
 	stream.Write(count);
 	for (int i = 0; i < count; i++)
@@ -69,8 +84,9 @@ int RawStruct<rpg::EventCommand>::LcfSize(const rpg::EventCommand& event_command
 	int result = 0;
 	result += LcfReader::IntSize(event_command.code);
 	result += LcfReader::IntSize(event_command.indent);
-	result += LcfReader::IntSize(stream.Decode(event_command.string).size());
-	result += stream.Decode(event_command.string).size();
+	int str_size = stream.DecodeCached(event_command.string).size();
+	result += LcfReader::IntSize(str_size);
+	result += str_size;
 	int count = event_command.parameters.size();
 	result += LcfReader::IntSize(count);
 	for (int i = 0; i < count; i++)
@@ -140,19 +156,18 @@ void RawStruct<rpg::EventCommand>::BeginXml(rpg::EventCommand& ref, XmlReader& s
 	stream.SetHandler(new WrapperXmlHandler("EventCommand", new EventCommandXmlHandler(ref)));
 }
 
+namespace {
+
 /**
- * Reads event commands.
+ * Calls read_command(endpos) for every command of a list.
+ * Event Commands is a special array: it has no size information
+ * and is terminated by 4 times 0x00.
  */
-void RawStruct<std::vector<rpg::EventCommand> >::ReadLcf(
-	std::vector<rpg::EventCommand>& event_commands, LcfReader& stream, uint32_t length) {
-	// Event Commands is a special array
-	// Has no size information. Is terminated by 4 times 0x00.
+template <typename F>
+void ReadEventCommands(LcfReader& stream, uint32_t length, F&& read_command) {
 	unsigned long startpos = stream.Tell();
 	unsigned long endpos = startpos + length;
 
-	// Since we don't know the number of event parameters without reading, we store
-	// them all in a temporary buffer and then copy it to EventCommand::parameters.
-	// This prevents extra allocations from repeated calls to push_back().
 	for (;;) {
 		uint8_t ch = (uint8_t)stream.Peek();
 		if (ch == 0) {
@@ -182,12 +197,52 @@ void RawStruct<std::vector<rpg::EventCommand> >::ReadLcf(
 			break;
 		}
 
-		rpg::EventCommand command;
-		RawStruct<rpg::EventCommand>::ReadLcf(command, stream, 0);
-		event_commands.push_back(command);
+		read_command(static_cast<uint32_t>(endpos));
 	}
 }
 
+} // namespace
+
+/**
+ * Reads event commands.
+ */
+void RawStruct<std::vector<rpg::EventCommand> >::ReadLcf(
+	std::vector<rpg::EventCommand>& event_commands, LcfReader& stream, uint32_t length) {
+	ReadEventCommands(stream, length, [&](uint32_t endpos) {
+		event_commands.emplace_back();
+		RawStruct<rpg::EventCommand>::ReadLcf(event_commands.back(), stream, endpos - stream.Tell());
+	});
+}
+
+void EventCommandList::ReadLcf(LcfReader& stream, uint32_t length) {
+	clear();
+
+	auto& str = stream.StrBuffer();
+	ReadEventCommands(stream, length, [&](uint32_t endpos) {
+		int32_t code = 0;
+		int32_t indent = 0;
+		stream.Read(code);
+		if (code != 0) {
+			stream.Read(indent);
+			stream.ReadString(str, stream.ReadInt());
+		} else {
+			str.clear();
+		}
+		_codes.push_back(code);
+		_indents.push_back(indent);
+		_strings += str;
+		_string_offsets.push_back(static_cast<uint32_t>(_strings.size()));
+
+		int count = code != 0 ? ClampParameterCount(stream, stream.ReadInt(), endpos) : 0;
+		if (count > 0) {
+			const auto old_size = _parameters.size();
+			_parameters.resize(old_size + count);
+			stream.ReadInts(_parameters.data() + old_size, count);
+		}
+		_parameter_offsets.push_back(static_cast<uint32_t>(_parameters.size()));
+	});
+}
+
 void RawStruct<std::vector<rpg::EventCommand> >::WriteLcf(const std::vector<rpg::EventCommand>& event_commands, LcfWriter& stream) {
 	int count = event_commands.size();
 	for (int i = 0; i < count; i++)
@@ -205,6 +260,23 @@ int RawStruct<std::vector<rpg::EventCommand> >::LcfSize(const std::vector<rpg::E
 	return result;
 }
 
+void EventCommandList::WriteLcf(LcfWriter& stream) const {
+	for (size_t i = 0; i < size(); ++i) {
+		stream.Write(code(i));
+		stream.Write(indent(i));
+		auto str = stream.DecodeBuffered(string(i));
+		stream.WriteInt(str.size());
+		stream.Write(str.data(), 1, str.size());
+		auto params = parameters(i);
+		stream.WriteInt(static_cast<int>(params.size()));
+		for (auto param: params) {
+			stream.WriteInt(param);
+		}
+	}
+	for (int i = 0; i < 4; i++)
+		stream.WriteInt(0);
+}
+
 void RawStruct<std::vector<rpg::EventCommand> >::WriteXml(const std::vector<rpg::EventCommand>& event_commands, XmlWriter& stream) {
 	std::vector<rpg::EventCommand>::const_iterator it;
 	for (it = event_commands.begin(); it != event_commands.end(); it++)
@@ -218,8 +290,7 @@ public:
 	void StartElement(XmlReader& stream, const char* name, const char** /* atts */) {
 		if (strcmp(name, "EventCommand") != 0)
 			Log::Error("XML: Expecting %s but got %s", "EventCommand", name);
-		ref.resize(ref.size() + 1);
-		rpg::EventCommand& obj = ref.back();
+		rpg::EventCommand& obj = ref.emplace_back();
 		stream.SetHandler(new EventCommandXmlHandler(obj));
 	}
 private:
@@ -7,29 +7,74 @@
  * file that was distributed with this source code.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <cerrno>
 #include <cstring>
+#include <exception>
+#include <thread>
 
 #include "lcf/ldb/reader.h"
 #include "lcf/ldb/chunks.h"
+#include "lcf/dbarena.h"
+#include "lcf/dbstringpool.h"
 #include "lcf/reader_util.h"
+#include "lcf_cache.h"
 #include "log.h"
+#include "mapped_file.h"
 #include "reader_struct.h"
 
 namespace lcf {
 
+static bool SaveImpl(LcfWriter& writer, const lcf::rpg::Database& db, SaveOpt opt);
+
 void LDB_Reader::PrepareSave(rpg::Database& db) {
 	++db.system.save_count;
 }
 
 std::unique_ptr<lcf::rpg::Database> LDB_Reader::Load(std::string_view filename, std::string_view encoding) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LDB file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return nullptr;
+	}
+	return LDB_Reader::Load(file.Data(), encoding);
+}
+
+std::unique_ptr<lcf::rpg::Database> LDB_Reader::Load(std::string_view filename, std::string_view encoding, std::string_view cache_dir) {
+	if (cache_dir.empty()) {
+		return LDB_Reader::Load(filename, encoding);
+	}
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LDB file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LDB_Reader::Load(stream, encoding);
+
+	const auto hash = LcfCache::Hash(file.Data());
+	const auto cache_path = LcfCache::GetPath(cache_dir, filename, encoding);
+	MappedFile cache;
+	if (cache.Open(cache_path)) {
+		auto payload = LcfCache::GetPayload(cache.Data(), LcfCache::Kind::Database, hash, encoding);
+		if (!payload.empty()) {
+			if (auto db = LDB_Reader::Load(payload)) {
+				return db;
+			}
+		}
+		cache.Close();
+	}
+
+	auto db = LDB_Reader::Load(file.Data(), encoding);
+	if (db) {
+		// Keep the 2k3 fields of a 2k database, a cached load must match a direct one
+		LcfWriter writer(GetEngineVersion(*db));
+		writer.SetKeep2k3Fields(true);
+		if (SaveImpl(writer, *db, SaveOpt::ePreserveHeader)) {
+			LcfCache::Write(cache_path, LcfCache::Kind::Database, hash, encoding, writer.TakeBuffer());
+		}
+	}
+	return db;
 }
 
 bool LDB_Reader::Save(std::string_view filename, const lcf::rpg::Database& db, std::string_view encoding, SaveOpt opt) {
@@ -41,56 +86,164 @@ bool LDB_Reader::Save(std::string_view filename, const lcf::rpg::Database& db, s
 	return LDB_Reader::Save(stream, db, encoding, opt);
 }
 
-bool LDB_Reader::SaveXml(std::string_view filename, const lcf::rpg::Database& db) {
+bool LDB_Reader::SaveXml(std::string_view filename, const lcf::rpg::Database& db, SaveOpt opt) {
 	std::ofstream stream(ToString(filename), std::ios::binary);
 	if (!stream.is_open()) {
 		Log::Error("Failed to open LDB XML file '%s' for writing: %s", ToString(filename).c_str(), strerror(errno));
 		return false;
 	}
-	return LDB_Reader::SaveXml(stream, db);
+	return LDB_Reader::SaveXml(stream, db, opt);
 }
 
 std::unique_ptr<lcf::rpg::Database> LDB_Reader::LoadXml(std::string_view filename) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LDB XML file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LDB_Reader::LoadXml(stream);
+	return LDB_Reader::LoadXml(file.Data());
 }
 
-std::unique_ptr<lcf::rpg::Database> LDB_Reader::Load(std::istream& filestream, std::string_view encoding) {
-	LcfReader reader(filestream, ToString(encoding));
+static bool ReadHeader(LcfReader& reader, std::string& header) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse database file.");
-		return nullptr;
+		return false;
 	}
-	std::string header;
 	reader.ReadString(header, reader.ReadInt());
 	if (header.length() != 11) {
 		LcfReader::SetError("This is not a valid RPG2000 database.");
-		return nullptr;
+		return false;
 	}
 	if (header != "LcfDataBase") {
 		Log::Warning("Header %s != LcfDataBase and might not be a valid RPG2000 database.", header.c_str());
 	}
-	auto db = std::make_unique<lcf::rpg::Database>();
-	db->ldb_header = header;
-	TypeReader<rpg::Database>::ReadLcf(*db, reader, 0);
+	return true;
+}
 
-	const auto engine = GetEngineVersion(*db);
+static void SetupActors(rpg::Database& db) {
+	const auto engine = GetEngineVersion(db);
 	// Delayed initialization of some actor fields because they are engine
 	// dependent
-	for (auto& actor: db->actors) {
+	for (auto& actor: db.actors) {
 		actor.Setup(engine == EngineVersion::e2k3);
 	}
+}
+
+/**
+ * Calls f(chunk_info, offset) for every top-level chunk without parsing
+ * the chunk bodies.
+ */
+template <typename F>
+static void ScanSections(LcfReader& reader, F&& f) {
+	LcfReader::Chunk chunk_info;
+
+	while (!reader.Eof()) {
+		chunk_info.ID = reader.ReadInt();
+		if (chunk_info.ID == 0) {
+			break;
+		}
+		chunk_info.length = reader.ReadInt();
+
+		const uint32_t offset = reader.Tell();
+		f(chunk_info, offset);
+		reader.Seek(chunk_info.length, LcfReader::FromCurrent);
+	}
+}
+
+static std::unique_ptr<lcf::rpg::Database> LoadImpl(LcfReader& reader) {
+	std::string header;
+	if (!ReadHeader(reader, header)) {
+		return nullptr;
+	}
+	auto db = std::make_unique<lcf::rpg::Database>();
+	db->ldb_header = header;
+	TypeReader<rpg::Database>::ReadLcf(*db, reader, 0);
+
+	SetupActors(*db);
 
 	return db;
 }
 
-bool LDB_Reader::Save(std::ostream& filestream, const lcf::rpg::Database& db, std::string_view encoding, SaveOpt opt) {
-	const auto engine = GetEngineVersion(db);
-	LcfWriter writer(filestream, engine, ToString(encoding));
+std::unique_ptr<lcf::rpg::Database> LDB_Reader::Load(std::istream& filestream, std::string_view encoding) {
+	LcfReader reader(filestream, ToString(encoding));
+	return LoadImpl(reader);
+}
+
+std::unique_ptr<lcf::rpg::Database> LDB_Reader::Load(Span<const uint8_t> buffer, std::string_view encoding) {
+	LcfReader reader(buffer, ToString(encoding));
+	return LoadImpl(reader);
+}
+
+bool LDB_Reader::Visit(std::string_view filename, ChunkVisitor& visitor) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LDB file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return false;
+	}
+	return LDB_Reader::Visit(file.Data(), visitor);
+}
+
+bool LDB_Reader::Visit(Span<const uint8_t> buffer, ChunkVisitor& visitor) {
+	LcfReader reader(buffer);
+	std::string header;
+	if (!ReadHeader(reader, header)) {
+		return false;
+	}
+	auto data = buffer.subspan(reader.Tell());
+	return Struct<rpg::Database>::VisitLcf(data, 0, 0, visitor);
+}
+
+std::vector<EventCommandList> LDB_Reader::LoadEventCommands(std::string_view filename, std::string_view encoding) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LDB file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return {};
+	}
+	return LDB_Reader::LoadEventCommands(file.Data(), encoding);
+}
+
+std::vector<EventCommandList> LDB_Reader::LoadEventCommands(Span<const uint8_t> buffer, std::string_view encoding) {
+	/** Only enters the common events and reads their command lists */
+	class CommonEventVisitor : public ChunkVisitor {
+	public:
+		CommonEventVisitor(Span<const uint8_t> buffer, std::string_view encoding)
+			: buffer(buffer), reader(buffer, ToString(encoding)) {}
+
+		bool BeginStruct(const char* struct_name, int32_t, int) override {
+			if (std::strcmp(struct_name, "CommonEvent") == 0) {
+				lists.emplace_back();
+			}
+			return true;
+		}
+
+		bool BeginChunk(const Chunk& chunk) override {
+			if (chunk.field_name == nullptr) {
+				return false;
+			}
+			if (std::strcmp(chunk.struct_name, "Database") == 0) {
+				return std::strcmp(chunk.field_name, "commonevents") == 0;
+			}
+			if (std::strcmp(chunk.field_name, "event_commands") == 0) {
+				reader.Clear();
+				reader.Seek(static_cast<uint32_t>(chunk.data.data() - buffer.data()));
+				lists.back().ReadLcf(reader, static_cast<uint32_t>(chunk.data.size()));
+			}
+			return false;
+		}
+
+		Span<const uint8_t> buffer;
+		LcfReader reader;
+		std::vector<EventCommandList> lists;
+	};
+
+	CommonEventVisitor visitor(buffer, encoding);
+	if (!LDB_Reader::Visit(buffer, visitor)) {
+		return {};
+	}
+	return std::move(visitor.lists);
+}
+
+static bool SaveImpl(LcfWriter& writer, const lcf::rpg::Database& db, SaveOpt opt) {
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse database file.");
 		return false;
@@ -107,9 +260,26 @@ bool LDB_Reader::Save(std::ostream& filestream, const lcf::rpg::Database& db, st
 	return true;
 }
 
-bool LDB_Reader::SaveXml(std::ostream& filestream, const lcf::rpg::Database& db) {
+bool LDB_Reader::Save(std::ostream& filestream, const lcf::rpg::Database& db, std::string_view encoding, SaveOpt opt) {
+	LcfWriter writer(filestream, GetEngineVersion(db), ToString(encoding));
+	if (!SaveImpl(writer, db, opt)) {
+		return false;
+	}
+	writer.Flush();
+	return writer.IsOk();
+}
+
+std::vector<uint8_t> LDB_Reader::SaveToBuffer(const lcf::rpg::Database& db, std::string_view encoding, SaveOpt opt) {
+	LcfWriter writer(GetEngineVersion(db), ToString(encoding));
+	if (!SaveImpl(writer, db, opt)) {
+		return {};
+	}
+	return writer.TakeBuffer();
+}
+
+bool LDB_Reader::SaveXml(std::ostream& filestream, const lcf::rpg::Database& db, SaveOpt opt) {
 	const auto engine = GetEngineVersion(db);
-	XmlWriter writer(filestream, engine);
+	XmlWriter writer(filestream, engine, bool(opt & SaveOpt::eCompactXml));
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse database file.\n");
 		return false;
@@ -117,11 +287,11 @@ bool LDB_Reader::SaveXml(std::ostream& filestream, const lcf::rpg::Database& db)
 	writer.BeginElement("LDB");
 	TypeReader<rpg::Database>::WriteXml(db, writer);
 	writer.EndElement("LDB");
-	return true;
+	writer.Flush();
+	return writer.IsOk();
 }
 
-std::unique_ptr<lcf::rpg::Database> LDB_Reader::LoadXml(std::istream& filestream) {
-	XmlReader reader(filestream);
+static std::unique_ptr<lcf::rpg::Database> LoadXmlImpl(XmlReader& reader) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse database file.\n");
 		return nullptr;;
@@ -130,14 +300,216 @@ std::unique_ptr<lcf::rpg::Database> LDB_Reader::LoadXml(std::istream& filestream
 	reader.SetHandler(new RootXmlHandler<rpg::Database>(*db, "LDB"));
 	reader.Parse();
 
-	const auto engine = GetEngineVersion(*db);
-	// Delayed initialization of some actor fields because they are engine
-	// dependent
-	for (auto& actor: db->actors) {
-		actor.Setup(engine == EngineVersion::e2k3);
+	SetupActors(*db);
+
+	return db;
+}
+
+std::unique_ptr<lcf::rpg::Database> LDB_Reader::LoadXml(std::istream& filestream) {
+	XmlReader reader(filestream);
+	return LoadXmlImpl(reader);
+}
+
+std::unique_ptr<lcf::rpg::Database> LDB_Reader::LoadXml(Span<const uint8_t> buffer) {
+	XmlReader reader(buffer);
+	return LoadXmlImpl(reader);
+}
+
+std::unique_ptr<lcf::rpg::Database> LDB_Reader::LoadParallel(std::string_view filename, std::string_view encoding, unsigned threads) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LDB file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return nullptr;
 	}
+	return LDB_Reader::LoadParallel(file.Data(), encoding, threads);
+}
 
+std::unique_ptr<lcf::rpg::Database> LDB_Reader::LoadParallel(Span<const uint8_t> buffer, std::string_view encoding, unsigned threads) {
+	struct Section {
+		LcfReader::Chunk chunk_info;
+		uint32_t offset;
+	};
+
+	LcfReader reader(buffer, ToString(encoding));
+	std::string header;
+	if (!ReadHeader(reader, header)) {
+		return nullptr;
+	}
+
+	std::vector<Section> sections;
+	uint64_t seen = 0;
+	bool duplicate = false;
+	ScanSections(reader, [&](const LcfReader::Chunk& chunk_info, uint32_t offset) {
+		const auto bit = uint64_t(1) << (chunk_info.ID % 64);
+		duplicate |= chunk_info.ID >= 64 || (seen & bit) != 0;
+		seen |= bit;
+		sections.push_back({ chunk_info, offset });
+	});
+
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+	threads = std::min<unsigned>(threads, sections.size());
+	if (threads <= 1 || duplicate) {
+		// Repeated chunks are merged into the previous data, which only
+		// works in file order
+		return Load(buffer, encoding);
+	}
+
+	// The sections write to distinct members of the database, so they can
+	// be parsed concurrently. Start with the largest ones.
+	std::stable_sort(sections.begin(), sections.end(), [](const Section& l, const Section& r) {
+		return l.chunk_info.length > r.chunk_info.length;
+	});
+
+	auto db = std::make_unique<lcf::rpg::Database>();
+	db->ldb_header = header;
+
+	std::atomic<size_t> next(0);
+	std::vector<std::exception_ptr> errors(threads);
+	// The log handler is not thread-safe, it only sees the calling thread
+	std::vector<Log::Buffer> logs(threads);
+	const bool use_arena = DBArenaScope::IsActive();
+	auto* string_pool = DBStringPool::Current();
+
+	auto worker = [&](unsigned id) {
+		Log::Buffer::Scope log_scope(logs[id]);
+		try {
+			// Arena and string pool scopes are per thread
+			std::unique_ptr<DBArenaScope> arena;
+			if (use_arena && id > 0) {
+				arena = std::make_unique<DBArenaScope>();
+			}
+			std::unique_ptr<DBStringPool::Scope> string_pool_scope;
+			if (string_pool && id > 0) {
+				string_pool_scope = std::make_unique<DBStringPool::Scope>(*string_pool);
+			}
+			LcfReader worker_reader(buffer, ToString(encoding));
+			for (size_t i = next++; i < sections.size(); i = next++) {
+				worker_reader.Seek(sections[i].offset);
+				Struct<rpg::Database>::ReadLcfChunk(*db, worker_reader, sections[i].chunk_info);
+			}
+		} catch (...) {
+			errors[id] = std::current_exception();
+			next = sections.size();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads; ++i) {
+		pool.emplace_back(worker, i);
+	}
+	worker(0);
+	for (auto& thread: pool) {
+		thread.join();
+	}
+	for (auto& log: logs) {
+		log.Flush();
+	}
+	for (auto& error: errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	SetupActors(*db);
+
+	return db;
+}
+
+std::unique_ptr<LDB_Reader::LazyDatabase> LDB_Reader::LoadLazy(std::string_view filename, std::string_view encoding) {
+	auto file = std::make_unique<MappedFile>();
+	if (!file->Open(filename)) {
+		Log::Error("Failed to open LDB file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return nullptr;
+	}
+	auto db = LoadLazy(file->Data(), encoding);
+	if (db) {
+		db->_file = std::move(file);
+	}
+	return db;
+}
+
+std::unique_ptr<LDB_Reader::LazyDatabase> LDB_Reader::LoadLazy(Span<const uint8_t> buffer, std::string_view encoding) {
+	return LazyDatabase::Open(std::make_unique<LcfReader>(buffer, ToString(encoding)));
+}
+
+LDB_Reader::LazyDatabase::LazyDatabase() = default;
+
+LDB_Reader::LazyDatabase::~LazyDatabase() = default;
+
+std::unique_ptr<LDB_Reader::LazyDatabase> LDB_Reader::LazyDatabase::Open(std::unique_ptr<LcfReader> reader) {
+	std::unique_ptr<LazyDatabase> db(new LazyDatabase());
+	if (!ReadHeader(*reader, db->_db.ldb_header)) {
+		return nullptr;
+	}
+
+	auto& sections = db->_sections;
+	ScanSections(*reader, [&](const LcfReader::Chunk& chunk_info, uint32_t offset) {
+		if (chunk_info.ID > ChunkDatabase::battleranimations) {
+			// Unknown, the regular reader skips these as well
+			return;
+		}
+		if (chunk_info.ID >= sections.size()) {
+			sections.resize(chunk_info.ID + 1);
+		}
+		// Repeated chunks are merged into the previous data like in Load
+		sections[chunk_info.ID].chunks.push_back({ offset, chunk_info.length });
+	});
+
+	db->_reader = std::move(reader);
 	return db;
 }
 
+rpg::Database& LDB_Reader::LazyDatabase::Get(ChunkDatabase::Index section) {
+	if (IsLoaded(section)) {
+		return _db;
+	}
+	if (section == ChunkDatabase::actors) {
+		// Actor setup depends on the engine version in the system section
+		Get(ChunkDatabase::system);
+	}
+	if (static_cast<size_t>(section) >= _sections.size()) {
+		_sections.resize(section + 1);
+	}
+
+	auto& info = _sections[section];
+	info.loaded = true;
+	if (info.chunks.empty()) {
+		return _db;
+	}
+
+	for (const auto& chunk: info.chunks) {
+		// Sections are independent, a corrupted one must not stop the others
+		_reader->Clear();
+		_reader->Seek(chunk.offset);
+		LcfReader::Chunk chunk_info;
+		chunk_info.ID = section;
+		chunk_info.length = chunk.length;
+		Struct<rpg::Database>::ReadLcfChunk(_db, *_reader, chunk_info);
+	}
+
+	if (section == ChunkDatabase::actors) {
+		SetupActors(_db);
+	}
+	return _db;
+}
+
+rpg::Database& LDB_Reader::LazyDatabase::GetAll() {
+	for (size_t i = 0; i < _sections.size(); ++i) {
+		if (!_sections[i].chunks.empty()) {
+			Get(static_cast<ChunkDatabase::Index>(i));
+		}
+	}
+	return _db;
+}
+
+bool LDB_Reader::LazyDatabase::Has(ChunkDatabase::Index section) const {
+	return static_cast<size_t>(section) < _sections.size() && !_sections[section].chunks.empty();
+}
+
+bool LDB_Reader::LazyDatabase::IsLoaded(ChunkDatabase::Index section) const {
+	return static_cast<size_t>(section) < _sections.size() && _sections[section].loaded;
+}
+
 } // namespace lcf
@@ -15,17 +15,18 @@
 #include "lcf/lmt/chunks.h"
 #include "lcf/reader_util.h"
 #include "log.h"
+#include "mapped_file.h"
 #include "reader_struct.h"
 
 namespace lcf {
 
 std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::Load(std::string_view filename, std::string_view encoding) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LMT file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LMT_Reader::Load(stream, encoding);
+	return LMT_Reader::Load(file.Data(), encoding);
 }
 
 bool LMT_Reader::Save(std::string_view filename, const lcf::rpg::TreeMap& tmap, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
@@ -37,26 +38,25 @@ bool LMT_Reader::Save(std::string_view filename, const lcf::rpg::TreeMap& tmap,
 	return LMT_Reader::Save(stream, tmap, engine, encoding, opt);
 }
 
-bool LMT_Reader::SaveXml(std::string_view filename, const lcf::rpg::TreeMap& tmap, EngineVersion engine) {
+bool LMT_Reader::SaveXml(std::string_view filename, const lcf::rpg::TreeMap& tmap, EngineVersion engine, SaveOpt opt) {
 	std::ofstream stream(ToString(filename), std::ios::binary);
 	if (!stream.is_open()) {
 		Log::Error("Failed to open LMT XML file '%s' for writing: %s", ToString(filename).c_str(), strerror(errno));
 		return false;
 	}
-	return LMT_Reader::SaveXml(stream, tmap, engine);
+	return LMT_Reader::SaveXml(stream, tmap, engine, opt);
 }
 
 std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::LoadXml(std::string_view filename) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LMT XML file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LMT_Reader::LoadXml(stream);
+	return LMT_Reader::LoadXml(file.Data());
 }
 
-std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::Load(std::istream& filestream, std::string_view encoding) {
-	LcfReader reader(filestream, ToString(encoding));
+static std::unique_ptr<lcf::rpg::TreeMap> LoadImpl(LcfReader& reader) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse map tree file.");
 		return nullptr;
@@ -76,8 +76,17 @@ std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::Load(std::istream& filestream, st
 	return tmap;
 }
 
-bool LMT_Reader::Save(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
-	LcfWriter writer(filestream, engine, ToString(encoding));
+std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::Load(std::istream& filestream, std::string_view encoding) {
+	LcfReader reader(filestream, ToString(encoding));
+	return LoadImpl(reader);
+}
+
+std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::Load(Span<const uint8_t> buffer, std::string_view encoding) {
+	LcfReader reader(buffer, ToString(encoding));
+	return LoadImpl(reader);
+}
+
+static bool SaveImpl(LcfWriter& writer, const lcf::rpg::TreeMap& tmap, SaveOpt opt) {
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse map tree file.");
 		return false;
@@ -94,8 +103,25 @@ bool LMT_Reader::Save(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, E
 	return true;
 }
 
-bool LMT_Reader::SaveXml(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, EngineVersion engine) {
-	XmlWriter writer(filestream, engine);
+bool LMT_Reader::Save(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
+	LcfWriter writer(filestream, engine, ToString(encoding));
+	if (!SaveImpl(writer, tmap, opt)) {
+		return false;
+	}
+	writer.Flush();
+	return writer.IsOk();
+}
+
+std::vector<uint8_t> LMT_Reader::SaveToBuffer(const lcf::rpg::TreeMap& tmap, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
+	LcfWriter writer(engine, ToString(encoding));
+	if (!SaveImpl(writer, tmap, opt)) {
+		return {};
+	}
+	return writer.TakeBuffer();
+}
+
+bool LMT_Reader::SaveXml(std::ostream& filestream, const lcf::rpg::TreeMap& tmap, EngineVersion engine, SaveOpt opt) {
+	XmlWriter writer(filestream, engine, bool(opt & SaveOpt::eCompactXml));
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse map tree file.");
 		return false;
@@ -103,11 +129,11 @@ bool LMT_Reader::SaveXml(std::ostream& filestream, const lcf::rpg::TreeMap& tmap
 	writer.BeginElement("LMT");
 	TypeReader<rpg::TreeMap>::WriteXml(tmap, writer);
 	writer.EndElement("LMT");
-	return true;
+	writer.Flush();
+	return writer.IsOk();
 }
 
-std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::LoadXml(std::istream& filestream) {
-	XmlReader reader(filestream);
+static std::unique_ptr<lcf::rpg::TreeMap> LoadXmlImpl(XmlReader& reader) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse map tree file.");
 		return nullptr;
@@ -118,4 +144,14 @@ std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::LoadXml(std::istream& filestream)
 	return tmap;
 }
 
+std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::LoadXml(std::istream& filestream) {
+	XmlReader reader(filestream);
+	return LoadXmlImpl(reader);
+}
+
+std::unique_ptr<lcf::rpg::TreeMap> LMT_Reader::LoadXml(Span<const uint8_t> buffer) {
+	XmlReader reader(buffer);
+	return LoadXmlImpl(reader);
+}
+
 } //namespace lcf
@@ -59,6 +59,13 @@ void RawStruct<rpg::MoveCommand>::ReadLcf(rpg::MoveCommand& ref, LcfReader& stre
 }
 
 void RawStruct<rpg::MoveCommand>::WriteLcf(const rpg::MoveCommand& ref, LcfWriter& stream) {
+	// The size pass of the move route decodes the same strings, see DecodeCached
+	auto WriteString = [](const DBString& str, LcfWriter& stream) {
+		auto native = stream.DecodeCached(str);
+		stream.WriteInt(native.size());
+		stream.Write(native.data(), 1, native.size());
+	};
+
 	stream.WriteInt(ref.command_id);
 	const auto cmd = static_cast<rpg::MoveCommand::Code>(ref.command_id);
 	switch (cmd) {
@@ -69,13 +76,11 @@ void RawStruct<rpg::MoveCommand>::WriteLcf(const rpg::MoveCommand& ref, LcfWrite
 			stream.Write(ref.parameter_a);
 			break;
 		case rpg::MoveCommand::Code::change_graphic:
-			stream.WriteInt(stream.Decode(ref.parameter_string).size());
-			stream.Write(ref.parameter_string);
+			WriteString(ref.parameter_string, stream);
 			stream.Write(ref.parameter_a);
 			break;
 		case rpg::MoveCommand::Code::play_sound_effect:
-			stream.WriteInt(stream.Decode(ref.parameter_string).size());
-			stream.Write(ref.parameter_string);
+			WriteString(ref.parameter_string, stream);
 			stream.Write(ref.parameter_a);
 			stream.Write(ref.parameter_b);
 			stream.Write(ref.parameter_c);
@@ -85,6 +90,11 @@ void RawStruct<rpg::MoveCommand>::WriteLcf(const rpg::MoveCommand& ref, LcfWrite
 }
 
 int RawStruct<rpg::MoveCommand>::LcfSize(const rpg::MoveCommand& ref, LcfWriter& stream) {
+	auto StringSize = [](const DBString& str, LcfWriter& stream) {
+		const int size = stream.DecodeCached(str).size();
+		return LcfReader::IntSize(size) + size;
+	};
+
 	int result = 0;
 	result += LcfReader::IntSize(ref.command_id);
 	const auto cmd = static_cast<rpg::MoveCommand::Code>(ref.command_id);
@@ -96,13 +106,11 @@ int RawStruct<rpg::MoveCommand>::LcfSize(const rpg::MoveCommand& ref, LcfWriter&
 			result += LcfReader::IntSize(ref.parameter_a);
 			break;
 		case rpg::MoveCommand::Code::change_graphic:
-			result += LcfReader::IntSize(stream.Decode(ref.parameter_string).size());
-			result += stream.Decode(ref.parameter_string).size();
+			result += StringSize(ref.parameter_string, stream);
 			result += LcfReader::IntSize(ref.parameter_a);
 			break;
 		case rpg::MoveCommand::Code::play_sound_effect:
-			result += LcfReader::IntSize(stream.Decode(ref.parameter_string).size());
-			result += stream.Decode(ref.parameter_string).size();
+			result += StringSize(ref.parameter_string, stream);
 			result += LcfReader::IntSize(ref.parameter_a);
 			result += LcfReader::IntSize(ref.parameter_b);
 			result += LcfReader::IntSize(ref.parameter_c);
@@ -219,8 +227,7 @@ public:
 	void StartElement(XmlReader& stream, const char* name, const char** /* atts */) {
 		if (strcmp(name, "MoveCommand") != 0)
 			Log::Error("XML: Expecting %s but got %s", "MoveCommand", name);
-		ref.resize(ref.size() + 1);
-		rpg::MoveCommand& obj = ref.back();
+		rpg::MoveCommand& obj = ref.emplace_back();
 		stream.SetHandler(new MoveCommandXmlHandler(obj));
 	}
 private:
@@ -16,7 +16,9 @@
 #include "lcf/lmu/chunks.h"
 #include "lcf/reader_lcf.h"
 #include "lcf/reader_util.h"
+#include "lcf_cache.h"
 #include "log.h"
+#include "mapped_file.h"
 #include "reader_struct.h"
 
 namespace lcf {
@@ -26,12 +28,46 @@ void LMU_Reader::PrepareSave(rpg::Map& map) {
 }
 
 std::unique_ptr<rpg::Map> LMU_Reader::Load(std::string_view filename, std::string_view encoding) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LMU file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LMU_Reader::Load(stream, encoding);
+	return LMU_Reader::Load(file.Data(), encoding);
+}
+
+std::unique_ptr<rpg::Map> LMU_Reader::Load(std::string_view filename, std::string_view encoding, std::string_view cache_dir) {
+	if (cache_dir.empty()) {
+		return LMU_Reader::Load(filename, encoding);
+	}
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LMU file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return nullptr;
+	}
+
+	const auto hash = LcfCache::Hash(file.Data());
+	const auto cache_path = LcfCache::GetPath(cache_dir, filename, encoding);
+	MappedFile cache;
+	if (cache.Open(cache_path)) {
+		auto payload = LcfCache::GetPayload(cache.Data(), LcfCache::Kind::Map, hash, encoding);
+		if (!payload.empty()) {
+			if (auto map = LMU_Reader::Load(payload)) {
+				return map;
+			}
+		}
+		cache.Close();
+	}
+
+	auto map = LMU_Reader::Load(file.Data(), encoding);
+	if (map) {
+		// 2k3 is a superset of the 2k format, no field is lost
+		const auto payload = LMU_Reader::SaveToBuffer(*map, EngineVersion::e2k3, "", SaveOpt::ePreserveHeader);
+		if (!payload.empty()) {
+			LcfCache::Write(cache_path, LcfCache::Kind::Map, hash, encoding, payload);
+		}
+	}
+	return map;
 }
 
 bool LMU_Reader::Save(std::string_view filename, const rpg::Map& save, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
@@ -43,39 +79,45 @@ bool LMU_Reader::Save(std::string_view filename, const rpg::Map& save, EngineVer
 	return LMU_Reader::Save(stream, save, engine, encoding, opt);
 }
 
-bool LMU_Reader::SaveXml(std::string_view filename, const rpg::Map& save, EngineVersion engine) {
+bool LMU_Reader::SaveXml(std::string_view filename, const rpg::Map& save, EngineVersion engine, SaveOpt opt) {
 	std::ofstream stream(ToString(filename), std::ios::binary);
 	if (!stream.is_open()) {
 		Log::Error("Failed to open LMU XML file '%s' for writing: %s", ToString(filename).c_str(), strerror(errno));
 		return false;
 	}
-	return LMU_Reader::SaveXml(stream, save, engine);
+	return LMU_Reader::SaveXml(stream, save, engine, opt);
 }
 
 std::unique_ptr<rpg::Map> LMU_Reader::LoadXml(std::string_view filename) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LMU XML file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LMU_Reader::LoadXml(stream);
+	return LMU_Reader::LoadXml(file.Data());
 }
 
-std::unique_ptr<rpg::Map> LMU_Reader::Load(std::istream& filestream, std::string_view encoding) {
-	LcfReader reader(filestream, ToString(encoding));
+static bool ReadHeader(LcfReader& reader, std::string& header) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse map file.");
-		return {};
+		return false;
 	}
-	std::string header;
 	reader.ReadString(header, reader.ReadInt());
 	if (header.length() != 10) {
 		LcfReader::SetError("This is not a valid RPG2000 map.");
-		return {};
+		return false;
 	}
 	if (header != "LcfMapUnit") {
 		Log::Warning("Header %s != LcfMapUnit and might not be a valid RPG2000 map.", header.c_str());
 	}
+	return true;
+}
+
+static std::unique_ptr<rpg::Map> LoadImpl(LcfReader& reader) {
+	std::string header;
+	if (!ReadHeader(reader, header)) {
+		return {};
+	}
 
 	auto map = std::make_unique<rpg::Map>();
 	map->lmu_header = std::move(header);
@@ -83,8 +125,91 @@ std::unique_ptr<rpg::Map> LMU_Reader::Load(std::istream& filestream, std::string
 	return map;
 }
 
-bool LMU_Reader::Save(std::ostream& filestream, const rpg::Map& map, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
-	LcfWriter writer(filestream, engine, ToString(encoding));
+std::unique_ptr<rpg::Map> LMU_Reader::Load(std::istream& filestream, std::string_view encoding) {
+	LcfReader reader(filestream, ToString(encoding));
+	return LoadImpl(reader);
+}
+
+std::unique_ptr<rpg::Map> LMU_Reader::Load(Span<const uint8_t> buffer, std::string_view encoding) {
+	LcfReader reader(buffer, ToString(encoding));
+	return LoadImpl(reader);
+}
+
+bool LMU_Reader::Visit(std::string_view filename, ChunkVisitor& visitor) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LMU file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return false;
+	}
+	return LMU_Reader::Visit(file.Data(), visitor);
+}
+
+bool LMU_Reader::Visit(Span<const uint8_t> buffer, ChunkVisitor& visitor) {
+	LcfReader reader(buffer);
+	std::string header;
+	if (!ReadHeader(reader, header)) {
+		return false;
+	}
+	auto data = buffer.subspan(reader.Tell());
+	return Struct<rpg::Map>::VisitLcf(data, 0, 0, visitor);
+}
+
+std::vector<std::vector<EventCommandList>> LMU_Reader::LoadEventCommands(std::string_view filename, std::string_view encoding) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LMU file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return {};
+	}
+	return LMU_Reader::LoadEventCommands(file.Data(), encoding);
+}
+
+std::vector<std::vector<EventCommandList>> LMU_Reader::LoadEventCommands(Span<const uint8_t> buffer, std::string_view encoding) {
+	/** Only enters the event pages and reads their command lists */
+	class EventPageVisitor : public ChunkVisitor {
+	public:
+		EventPageVisitor(Span<const uint8_t> buffer, std::string_view encoding)
+			: buffer(buffer), reader(buffer, ToString(encoding)) {}
+
+		bool BeginStruct(const char* struct_name, int32_t, int) override {
+			if (std::strcmp(struct_name, "Event") == 0) {
+				lists.emplace_back();
+			} else if (std::strcmp(struct_name, "EventPage") == 0) {
+				lists.back().emplace_back();
+			}
+			return true;
+		}
+
+		bool BeginChunk(const Chunk& chunk) override {
+			if (chunk.field_name == nullptr) {
+				return false;
+			}
+			if (std::strcmp(chunk.struct_name, "Map") == 0) {
+				return std::strcmp(chunk.field_name, "events") == 0;
+			}
+			if (std::strcmp(chunk.struct_name, "Event") == 0) {
+				return std::strcmp(chunk.field_name, "pages") == 0;
+			}
+			if (std::strcmp(chunk.field_name, "event_commands") == 0) {
+				reader.Clear();
+				reader.Seek(static_cast<uint32_t>(chunk.data.data() - buffer.data()));
+				lists.back().back().ReadLcf(reader, static_cast<uint32_t>(chunk.data.size()));
+			}
+			return false;
+		}
+
+		Span<const uint8_t> buffer;
+		LcfReader reader;
+		std::vector<std::vector<EventCommandList>> lists;
+	};
+
+	EventPageVisitor visitor(buffer, encoding);
+	if (!LMU_Reader::Visit(buffer, visitor)) {
+		return {};
+	}
+	return std::move(visitor.lists);
+}
+
+static bool SaveImpl(LcfWriter& writer, const rpg::Map& map, SaveOpt opt) {
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse map file.");
 		return false;
@@ -102,8 +227,25 @@ bool LMU_Reader::Save(std::ostream& filestream, const rpg::Map& map, EngineVersi
 	return true;
 }
 
-bool LMU_Reader::SaveXml(std::ostream& filestream, const rpg::Map& map, EngineVersion engine) {
-	XmlWriter writer(filestream, engine);
+bool LMU_Reader::Save(std::ostream& filestream, const rpg::Map& map, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
+	LcfWriter writer(filestream, engine, ToString(encoding));
+	if (!SaveImpl(writer, map, opt)) {
+		return false;
+	}
+	writer.Flush();
+	return writer.IsOk();
+}
+
+std::vector<uint8_t> LMU_Reader::SaveToBuffer(const rpg::Map& map, EngineVersion engine, std::string_view encoding, SaveOpt opt) {
+	LcfWriter writer(engine, ToString(encoding));
+	if (!SaveImpl(writer, map, opt)) {
+		return {};
+	}
+	return writer.TakeBuffer();
+}
+
+bool LMU_Reader::SaveXml(std::ostream& filestream, const rpg::Map& map, EngineVersion engine, SaveOpt opt) {
+	XmlWriter writer(filestream, engine, bool(opt & SaveOpt::eCompactXml));
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse map file.");
 		return false;
@@ -111,11 +253,11 @@ bool LMU_Reader::SaveXml(std::ostream& filestream, const rpg::Map& map, EngineVe
 	writer.BeginElement("LMU");
 	Struct<rpg::Map>::WriteXml(map, writer);
 	writer.EndElement("LMU");
-	return true;
+	writer.Flush();
+	return writer.IsOk();
 }
 
-std::unique_ptr<rpg::Map> LMU_Reader::LoadXml(std::istream& filestream) {
-	XmlReader reader(filestream);
+static std::unique_ptr<rpg::Map> LoadXmlImpl(XmlReader& reader) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse map file.");
 		return {};
@@ -127,4 +269,14 @@ std::unique_ptr<rpg::Map> LMU_Reader::LoadXml(std::istream& filestream) {
 	return map;
 }
 
+std::unique_ptr<rpg::Map> LMU_Reader::LoadXml(std::istream& filestream) {
+	XmlReader reader(filestream);
+	return LoadXmlImpl(reader);
+}
+
+std::unique_ptr<rpg::Map> LMU_Reader::LoadXml(Span<const uint8_t> buffer) {
+	XmlReader reader(buffer);
+	return LoadXmlImpl(reader);
+}
+
 } //namespace lcf
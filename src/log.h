@@ -10,6 +10,9 @@
 #ifndef LCF_LOG_H
 #define LCF_LOG_H
 
+#include <string>
+#include <utility>
+#include <vector>
 #include "lcf/log_handler.h"
 
 #ifdef __GNUG__
@@ -25,6 +28,35 @@ void Debug(const char* fmt, ...) LIKE_PRINTF;
 void Warning(const char* fmt, ...) LIKE_PRINTF;
 void Error(const char* fmt, ...) LIKE_PRINTF;
 
+/**
+ * Collects log messages instead of passing them to the log handler.
+ * Used by worker threads, the messages are passed on by Flush on the
+ * thread owning the handler.
+ */
+class Buffer {
+public:
+	/** Collects the messages logged on the calling thread while alive. */
+	class Scope {
+	public:
+		explicit Scope(Buffer& buffer);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		Buffer* prev = nullptr;
+	};
+
+	/** Passes the collected messages to the log handler and clears them */
+	void Flush();
+
+private:
+	friend void Output(LogHandler::Level level, std::string message);
+
+	std::vector<std::pair<LogHandler::Level, std::string>> messages;
+};
+
 } // namespace Log
 } // namespace lcf
 
@@ -8,6 +8,7 @@
  */
 
 #include "lcf/log_handler.h"
+#include "log.h"
 #include <cassert>
 #include <cstdarg>
 #include <cstdio>
@@ -65,6 +66,31 @@ namespace {
 
 		return {buf, static_cast<unsigned int>(result) < sizeof(buf) ? result : sizeof(buf)};
 	}
+
+	thread_local Buffer* current = nullptr;
+}
+
+void Output(LogHandler::Level level, std::string message) {
+	if (current) {
+		current->messages.emplace_back(level, std::move(message));
+	} else {
+		LogHandler::output_fn(level, message, LogHandler::output_userdata);
+	}
+}
+
+Buffer::Scope::Scope(Buffer& buffer) : prev(current) {
+	current = &buffer;
+}
+
+Buffer::Scope::~Scope() {
+	current = prev;
+}
+
+void Buffer::Flush() {
+	for (auto& message: messages) {
+		Output(message.first, std::move(message.second));
+	}
+	messages.clear();
 }
 
 void Debug(const char* fmt, ...) {
@@ -72,7 +98,7 @@ void Debug(const char* fmt, ...) {
 		va_list args;
 		va_start(args, fmt);
 		auto msg = format_string(fmt, args);
-		LogHandler::output_fn(LogHandler::Level::Debug, msg, LogHandler::output_userdata);
+		Output(LogHandler::Level::Debug, std::move(msg));
 		va_end(args);
 	}
 }
@@ -82,7 +108,7 @@ void Warning(const char* fmt, ...) {
 		va_list args;
 		va_start(args, fmt);
 		auto msg = format_string(fmt, args);
-		LogHandler::output_fn(LogHandler::Level::Warning, msg, LogHandler::output_userdata);
+		Output(LogHandler::Level::Warning, std::move(msg));
 		va_end(args);
 	}
 }
@@ -92,7 +118,7 @@ void Error(const char* fmt, ...) {
 		va_list args;
 		va_start(args, fmt);
 		auto msg = format_string(fmt, args);
-		LogHandler::output_fn(LogHandler::Level::Error, msg, LogHandler::output_userdata);
+		Output(LogHandler::Level::Error, std::move(msg));
 		va_end(args);
 	}
 }
@@ -17,6 +17,7 @@
 #include "lcf/rpg/save.h"
 #include "lcf/reader_util.h"
 #include "log.h"
+#include "mapped_file.h"
 #include "reader_struct.h"
 
 namespace lcf {
@@ -42,12 +43,12 @@ void LSD_Reader::PrepareSave(rpg::Save& save, int32_t version, int32_t codepage)
 }
 
 std::unique_ptr<rpg::Save> LSD_Reader::Load(std::string_view filename, std::string_view encoding) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LSD file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LSD_Reader::Load(stream, encoding);
+	return LSD_Reader::Load(file.Data(), encoding);
 }
 
 bool LSD_Reader::Save(std::string_view filename, const rpg::Save& save, EngineVersion engine, std::string_view encoding) {
@@ -59,71 +60,154 @@ bool LSD_Reader::Save(std::string_view filename, const rpg::Save& save, EngineVe
 	return LSD_Reader::Save(stream, save, engine, encoding);
 }
 
-bool LSD_Reader::SaveXml(std::string_view filename, const rpg::Save& save, EngineVersion engine) {
+bool LSD_Reader::SaveXml(std::string_view filename, const rpg::Save& save, EngineVersion engine, SaveOpt opt) {
 	std::ofstream stream(ToString(filename), std::ios::binary);
 	if (!stream.is_open()) {
 		Log::Error("Failed to open LSD XML file '%s' for writing: %s", ToString(filename).c_str(), strerror(errno));
 		return false;
 	}
-	return LSD_Reader::SaveXml(stream, save, engine);
+	return LSD_Reader::SaveXml(stream, save, engine, opt);
 }
 
 std::unique_ptr<rpg::Save> LSD_Reader::LoadXml(std::string_view filename) {
-	std::ifstream stream(ToString(filename), std::ios::binary);
-	if (!stream.is_open()) {
+	MappedFile file;
+	if (!file.Open(filename)) {
 		Log::Error("Failed to open LSD XML file `%s' for reading : %s", ToString(filename).c_str(), strerror(errno));
 		return nullptr;
 	}
-	return LSD_Reader::LoadXml(stream);
+	return LSD_Reader::LoadXml(file.Data());
 }
 
-std::unique_ptr<rpg::Save> LSD_Reader::Load(std::istream& filestream, std::string_view encoding) {
-	LcfReader reader(filestream, ToString(encoding));
-
+static bool ReadHeader(LcfReader& reader) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse save file.");
-		return {};
+		return false;
 	}
 	std::string header;
 	reader.ReadString(header, reader.ReadInt());
 	if (header.length() != 11) {
 		LcfReader::SetError("This is not a valid RPG2000 save.");
-		return {};
+		return false;
 	}
 	if (header != "LcfSaveData") {
 		Log::Warning("Header %s != LcfSaveData and might not be a valid RPG2000 save.", header.c_str());
 	}
+	return true;
+}
+
+/**
+ * Skips over the top-level chunks to find the codepage in easyrpg_data,
+ * which decides how all strings of the save are decoded.
+ *
+ * @return the codepage or 0 when the save has none.
+ */
+static int32_t ScanCodepage(LcfReader& reader) {
+	int32_t codepage = 0;
+	LcfReader::Chunk chunk_info;
+
+	while (!reader.Eof()) {
+		chunk_info.ID = reader.ReadInt();
+		if (chunk_info.ID == 0) {
+			break;
+		}
+		chunk_info.length = reader.ReadInt();
 
-	auto pos = reader.Tell();
+		const uint32_t end = reader.Tell() + chunk_info.length;
+		if (chunk_info.ID == LSD_Reader::ChunkSave::easyrpg_data) {
+			while (reader.Tell() < end && !reader.Eof()) {
+				const uint32_t id = reader.ReadInt();
+				if (id == 0) {
+					break;
+				}
+				const uint32_t length = reader.ReadInt();
+				const uint32_t off = reader.Tell();
+				if (id == LSD_Reader::ChunkSaveEasyRpgData::codepage) {
+					// Same result as Primitive<int32_t>::ReadLcf, which also
+					// warns about invalid lengths in the full parse
+					codepage = length >= 1 && length <= 5 ? reader.ReadInt() : 0;
+				}
+				reader.Seek(off + length);
+			}
+		}
+		reader.Seek(end);
+	}
+	return codepage;
+}
 
+static std::unique_ptr<rpg::Save> LoadImpl(LcfReader& reader) {
+	if (!reader.IsOk()) {
+		LcfReader::SetError("Couldn't parse save file.");
+		return {};
+	}
 	std::unique_ptr<rpg::Save> save(new rpg::Save());
 	Struct<rpg::Save>::ReadLcf(*save, reader);
+	return save;
+}
 
-	if (save->easyrpg_data.codepage > 0) {
-		filestream.clear();
+std::unique_ptr<rpg::Save> LSD_Reader::Load(std::istream& filestream, std::string_view encoding) {
+	LcfReader reader(filestream, ToString(encoding));
+	if (!ReadHeader(reader)) {
+		return {};
+	}
+
+	const uint32_t pos = reader.Tell();
+	const auto codepage = ScanCodepage(reader);
+	reader.Clear();
+
+	if (codepage > 0) {
 		filestream.seekg(pos, std::ios_base::beg);
-		LcfReader reader2(filestream, std::to_string(save->easyrpg_data.codepage));
-		if (!reader2.IsOk()) {
-			LcfReader::SetError("Couldn't parse save file.");
-			return {};
-		}
-		save.reset(new rpg::Save());
-		Struct<rpg::Save>::ReadLcf(*save, reader2);
+		LcfReader reader2(filestream, std::to_string(codepage));
+		return LoadImpl(reader2);
 	}
+	reader.Seek(pos);
+	return LoadImpl(reader);
+}
 
-	return save;
+std::unique_ptr<rpg::Save> LSD_Reader::Load(Span<const uint8_t> buffer, std::string_view encoding) {
+	LcfReader reader(buffer, ToString(encoding));
+	if (!ReadHeader(reader)) {
+		return {};
+	}
+
+	const uint32_t pos = reader.Tell();
+	const auto codepage = ScanCodepage(reader);
+	reader.Clear();
+
+	if (codepage > 0) {
+		LcfReader reader2(buffer, std::to_string(codepage));
+		reader2.Seek(pos);
+		return LoadImpl(reader2);
+	}
+	reader.Seek(pos);
+	return LoadImpl(reader);
 }
 
-bool LSD_Reader::Save(std::ostream& filestream, const rpg::Save& save, EngineVersion engine, std::string_view encoding) {
-	std::string enc;
+bool LSD_Reader::Visit(std::string_view filename, ChunkVisitor& visitor) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		Log::Error("Failed to open LSD file '%s' for reading: %s", ToString(filename).c_str(), strerror(errno));
+		return false;
+	}
+	return LSD_Reader::Visit(file.Data(), visitor);
+}
+
+bool LSD_Reader::Visit(Span<const uint8_t> buffer, ChunkVisitor& visitor) {
+	LcfReader reader(buffer);
+	if (!ReadHeader(reader)) {
+		return false;
+	}
+	auto data = buffer.subspan(reader.Tell());
+	return Struct<rpg::Save>::VisitLcf(data, 0, 0, visitor);
+}
 
+static std::string SaveEncoding(const rpg::Save& save, std::string_view encoding) {
 	if (save.easyrpg_data.codepage > 0) {
-		enc = std::to_string(save.easyrpg_data.codepage);
-	} else {
-		enc = ToString(encoding);
+		return std::to_string(save.easyrpg_data.codepage);
 	}
+	return ToString(encoding);
+}
 
-	LcfWriter writer(filestream, engine, enc);
+static bool SaveImpl(LcfWriter& writer, const rpg::Save& save) {
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse save file.\n");
 		return false;
@@ -136,8 +220,25 @@ bool LSD_Reader::Save(std::ostream& filestream, const rpg::Save& save, EngineVer
 	return true;
 }
 
-bool LSD_Reader::SaveXml(std::ostream& filestream, const rpg::Save& save, EngineVersion engine) {
-	XmlWriter writer(filestream, engine);
+bool LSD_Reader::Save(std::ostream& filestream, const rpg::Save& save, EngineVersion engine, std::string_view encoding) {
+	LcfWriter writer(filestream, engine, SaveEncoding(save, encoding));
+	if (!SaveImpl(writer, save)) {
+		return false;
+	}
+	writer.Flush();
+	return writer.IsOk();
+}
+
+std::vector<uint8_t> LSD_Reader::SaveToBuffer(const rpg::Save& save, EngineVersion engine, std::string_view encoding) {
+	LcfWriter writer(engine, SaveEncoding(save, encoding));
+	if (!SaveImpl(writer, save)) {
+		return {};
+	}
+	return writer.TakeBuffer();
+}
+
+bool LSD_Reader::SaveXml(std::ostream& filestream, const rpg::Save& save, EngineVersion engine, SaveOpt opt) {
+	XmlWriter writer(filestream, engine, bool(opt & SaveOpt::eCompactXml));
 	if (!writer.IsOk()) {
 		LcfReader::SetError("Couldn't parse save file.");
 		return false;
@@ -146,11 +247,11 @@ bool LSD_Reader::SaveXml(std::ostream& filestream, const rpg::Save& save, Engine
 	writer.BeginElement("LSD");
 	Struct<rpg::Save>::WriteXml(save, writer);
 	writer.EndElement("LSD");
-	return true;
+	writer.Flush();
+	return writer.IsOk();
 }
 
-std::unique_ptr<rpg::Save> LSD_Reader::LoadXml(std::istream& filestream) {
-	XmlReader reader(filestream);
+static std::unique_ptr<rpg::Save> LoadXmlImpl(XmlReader& reader) {
 	if (!reader.IsOk()) {
 		LcfReader::SetError("Couldn't parse save file.");
 		return {};
@@ -162,4 +263,14 @@ std::unique_ptr<rpg::Save> LSD_Reader::LoadXml(std::istream& filestream) {
 	return std::unique_ptr<rpg::Save>(save);
 }
 
+std::unique_ptr<rpg::Save> LSD_Reader::LoadXml(std::istream& filestream) {
+	XmlReader reader(filestream);
+	return LoadXmlImpl(reader);
+}
+
+std::unique_ptr<rpg::Save> LSD_Reader::LoadXml(Span<const uint8_t> buffer) {
+	XmlReader reader(buffer);
+	return LoadXmlImpl(reader);
+}
+
 } //namespace lcf
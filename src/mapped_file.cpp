@@ -0,0 +1,130 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "mapped_file.h"
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#  define LCF_MAPPED_FILE_WIN32
+#elif __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  define LCF_MAPPED_FILE_POSIX
+#endif
+
+namespace lcf {
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(std::string_view filename) {
+	Close();
+
+	const auto path = ToString(filename);
+
+#if defined(LCF_MAPPED_FILE_POSIX)
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		int err = errno;
+		::close(fd);
+		errno = err;
+		return false;
+	}
+
+	_size = static_cast<size_t>(st.st_size);
+	if (_size > 0) {
+		void* p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+#  ifdef POSIX_MADV_SEQUENTIAL
+			// The readers consume the file front to back
+			::posix_madvise(p, _size, POSIX_MADV_SEQUENTIAL);
+#  endif
+			_data = static_cast<const uint8_t*>(p);
+			_mapped = true;
+		}
+	}
+	::close(fd);
+
+	if (_mapped || _size == 0) {
+		_open = true;
+		return true;
+	}
+	_size = 0;
+#elif defined(LCF_MAPPED_FILE_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		errno = ENOENT;
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (p != nullptr) {
+				_data = static_cast<const uint8_t*>(p);
+				_size = static_cast<size_t>(file_size.QuadPart);
+				_mapping = mapping;
+				_mapped = true;
+			} else {
+				CloseHandle(mapping);
+			}
+		}
+	}
+	CloseHandle(file);
+
+	if (_mapped) {
+		_open = true;
+		return true;
+	}
+#endif
+
+	// Mapping not supported or failed: Read the whole file instead
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream.is_open()) {
+		return false;
+	}
+	_fallback.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	_data = _fallback.data();
+	_size = _fallback.size();
+	_open = true;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (_mapped) {
+#if defined(LCF_MAPPED_FILE_POSIX)
+		::munmap(const_cast<uint8_t*>(_data), _size);
+#elif defined(LCF_MAPPED_FILE_WIN32)
+		UnmapViewOfFile(_data);
+		CloseHandle(_mapping);
+		_mapping = nullptr;
+#endif
+	}
+	_fallback = {};
+	_data = nullptr;
+	_size = 0;
+	_open = false;
+	_mapped = false;
+}
+
+} // namespace lcf
@@ -0,0 +1,73 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_MAPPED_FILE_H
+#define LCF_MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "lcf/span.h"
+#include "lcf/string_view.h"
+
+namespace lcf {
+
+/**
+ * Read-only view of a whole file.
+ *
+ * The file is memory mapped when the platform supports it, otherwise
+ * the contents are read into an internal buffer.
+ */
+class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/**
+		 * Opens a file.
+		 *
+		 * @param filename file to open.
+		 * @return true on success. On failure errno describes the error.
+		 */
+		bool Open(std::string_view filename);
+
+		/** Unmaps the file and releases all resources. */
+		void Close();
+
+		/** @return whether a file is opened */
+		bool IsOpen() const;
+
+		/** @return the file contents */
+		Span<const uint8_t> Data() const;
+
+	private:
+		const uint8_t* _data = nullptr;
+		size_t _size = 0;
+		bool _open = false;
+		bool _mapped = false;
+#ifdef _WIN32
+		void* _mapping = nullptr;
+#endif
+		std::vector<uint8_t> _fallback;
+};
+
+inline bool MappedFile::IsOpen() const {
+	return _open;
+}
+
+inline Span<const uint8_t> MappedFile::Data() const {
+	return Span<const uint8_t>(_data, _size);
+}
+
+} // namespace lcf
+
+#endif
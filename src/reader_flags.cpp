@@ -41,7 +41,7 @@ void Flags<S>::ReadLcf(S& obj, LcfReader& stream, uint32_t length) {
 
 template <class S>
 void Flags<S>::WriteLcf(const S& obj, LcfWriter& stream) {
-	const bool db_is2k3 = stream.Is2k3();
+	const bool db_is2k3 = stream.Writes2k3Fields();
 
 	uint8_t byte = 0;
 	int bitidx = 0;
@@ -67,7 +67,7 @@ void Flags<S>::WriteLcf(const S& obj, LcfWriter& stream) {
 
 template <class S>
 int Flags<S>::LcfSize(const S& /* obj */, LcfWriter& stream) {
-	const bool db_is2k3 = stream.Is2k3();
+	const bool db_is2k3 = stream.Writes2k3Fields();
 	int num_bits = 0;
 	for (size_t i = 0; i < num_flags; ++i) {
 		const auto flag_is2k3 = flags_is2k3[i];
@@ -7,6 +7,7 @@
  * file that was distributed with this source code.
  */
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <iomanip>
@@ -15,27 +16,59 @@
 #include <sstream>
 
 #include "lcf/reader_lcf.h"
+#include "lcf/dbstringpool.h"
 #include "log.h"
 
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define LCF_READER_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
+#  define LCF_READER_NEON
+#endif
+
 namespace lcf {
 // Statics
 
 std::string LcfReader::error_str;
 
 LcfReader::LcfReader(std::istream& filestream, std::string encoding)
-	: stream(filestream)
+	: stream(&filestream)
 	, encoder(std::move(encoding))
 {
 	offset = filestream.tellg();
 }
 
+LcfReader::LcfReader(Span<const uint8_t> buffer, std::string encoding)
+	: data(buffer.data())
+	, data_size(buffer.size())
+	, offset(0)
+	, encoder(std::move(encoding))
+{
+}
+
 size_t LcfReader::Read0(void *ptr, size_t size, size_t nmemb) {
 	if (size == 0) { //avoid division by 0
 		return 0;
 	}
 	//Read nmemb elements of size and return the number of read elements
-	stream.read(reinterpret_cast<char*>(ptr), size*nmemb);
-	auto bytes_read = stream.gcount();
+	size_t bytes_read;
+	if (stream) {
+		stream->read(reinterpret_cast<char*>(ptr), size*nmemb);
+		bytes_read = stream->gcount();
+	} else {
+		bytes_read = std::min(size*nmemb, data_size - static_cast<size_t>(offset));
+		if (bytes_read > 0) {
+			std::memcpy(ptr, data + offset, bytes_read);
+		}
+		if (bytes_read != size*nmemb) {
+			data_eof = true;
+		}
+	}
 	offset += bytes_read;
 	size_t result = bytes_read / size;
 #ifdef NDEBUG
@@ -83,7 +116,146 @@ void LcfReader::Read<uint32_t>(uint32_t& ref) {
 	SwapByteOrder(ref);
 }
 
+namespace {
+
+inline uint64_t ByteSwap64(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_bswap64(v);
+#elif defined(_MSC_VER)
+	return _byteswap_uint64(v);
+#else
+	v = ((v & UINT64_C(0x00FF00FF00FF00FF)) << 8) | ((v >> 8) & UINT64_C(0x00FF00FF00FF00FF));
+	v = ((v & UINT64_C(0x0000FFFF0000FFFF)) << 16) | ((v >> 16) & UINT64_C(0x0000FFFF0000FFFF));
+	return (v << 32) | (v >> 32);
+#endif
+}
+
+/** @return index of the lowest set bit, v must not be 0 */
+inline int CountTrailingZeros64(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(v);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, v);
+	return static_cast<int>(index);
+#else
+	int n = 0;
+	while ((v & 1) == 0) {
+		v >>= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+/**
+ * Decodes a compressed integer from the 8 bytes starting at p without
+ * looping over the individual bytes.
+ *
+ * @param p pointer to at least 8 readable bytes.
+ * @param value decoded integer.
+ * @return amount of bytes consumed or 0 when the integer is longer than 8 bytes.
+ */
+inline size_t DecodeCompressedInt(const uint8_t* p, uint64_t& value) {
+	uint64_t word;
+	std::memcpy(&word, p, sizeof(word));
+#ifdef WORDS_BIGENDIAN
+	word = ByteSwap64(word);
+#endif
+	// The last byte of the integer is the first byte without the high bit
+	const uint64_t stop = ~word & UINT64_C(0x8080808080808080);
+	if (stop == 0) {
+		return 0;
+	}
+	const size_t len = CountTrailingZeros64(stop) / 8 + 1;
+
+	// Drop the bytes following the integer and move the first byte to the top
+	uint64_t x = ByteSwap64(word & (~UINT64_C(0) >> (64 - 8 * len))) & UINT64_C(0x7F7F7F7F7F7F7F7F);
+	// Pack the 7 bit groups together
+	x = (x & UINT64_C(0x007F007F007F007F)) | ((x & UINT64_C(0x7F007F007F007F00)) >> 1);
+	x = (x & UINT64_C(0x00003FFF00003FFF)) | ((x & UINT64_C(0x3FFF00003FFF0000)) >> 2);
+	x = (x & UINT64_C(0x000000000FFFFFFF)) | ((x & UINT64_C(0x0FFFFFFF00000000)) >> 4);
+	value = x >> (7 * (8 - len));
+	return len;
+}
+
+#ifdef WORDS_BIGENDIAN
+// Written as plain loops so that the compiler vectorizes them
+void SwapByteOrder16(uint16_t* p, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		p[i] = static_cast<uint16_t>((p[i] >> 8) | (p[i] << 8));
+	}
+}
+
+void SwapByteOrder32(uint32_t* p, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t v = p[i];
+		p[i] = (v >> 24) | ((v << 8) & 0x00FF0000) | ((v >> 8) & 0x0000FF00) | (v << 24);
+	}
+}
+#endif
+
+/**
+ * Packs one byte per bit into a bit array, bit i is set when src[i] is
+ * not zero and is stored in bit (i % 8) of dst[i / 8].
+ */
+void PackBits(const uint8_t* src, size_t count, uint8_t* dst) {
+	size_t i = 0;
+#if defined(LCF_READER_SSE2)
+	const auto zero = _mm_setzero_si128();
+	for (; count - i >= 16; i += 16) {
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		const unsigned mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+		dst[i / 8] = static_cast<uint8_t>(mask);
+		dst[i / 8 + 1] = static_cast<uint8_t>(mask >> 8);
+	}
+#elif defined(LCF_READER_NEON)
+	static const uint8_t weights_data[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	const auto weights = vld1q_u8(weights_data);
+	for (; count - i >= 16; i += 16) {
+		const auto v = vld1q_u8(src + i);
+		const auto bits = vandq_u8(vtstq_u8(v, v), weights);
+		dst[i / 8] = vaddv_u8(vget_low_u8(bits));
+		dst[i / 8 + 1] = vaddv_u8(vget_high_u8(bits));
+	}
+#endif
+	for (; count - i >= 8; i += 8) {
+		uint8_t byte = 0;
+		for (int bit = 0; bit < 8; ++bit) {
+			byte |= static_cast<uint8_t>((src[i + bit] != 0) << bit);
+		}
+		dst[i / 8] = byte;
+	}
+	if (i < count) {
+		uint8_t byte = 0;
+		for (int bit = 0; i + bit < count; ++bit) {
+			byte |= static_cast<uint8_t>((src[i + bit] != 0) << bit);
+		}
+		dst[i / 8] = byte;
+	}
+}
+
+} // namespace
+
 int LcfReader::ReadInt() {
+	if (data) {
+		const size_t avail = data_size - static_cast<size_t>(offset);
+		if (avail >= 8) {
+			const uint8_t* p = data + offset;
+			if (*p < 0x80) {
+				++offset;
+				return *p;
+			}
+			uint64_t value;
+			const size_t len = DecodeCompressedInt(p, value);
+			// Longer integers are invalid, handled below
+			if (len - 1 < 5) {
+				offset += len;
+				return static_cast<int>(static_cast<uint32_t>(value));
+			}
+		}
+	}
+
 	int value = 0;
 	unsigned char temp = 0;
 	int loops = 0;
@@ -104,7 +276,36 @@ int LcfReader::ReadInt() {
 	return loops > 5 ? 0 : value;
 }
 
+void LcfReader::ReadInts(int32_t* values, size_t count) {
+	size_t i = 0;
+	if (data) {
+		while (i < count && data_size - static_cast<size_t>(offset) >= 8) {
+			uint64_t value;
+			const size_t len = DecodeCompressedInt(data + offset, value);
+			if (len - 1 >= 5) {
+				break;
+			}
+			values[i++] = static_cast<int32_t>(static_cast<uint32_t>(value));
+			offset += len;
+		}
+	}
+
+	// End of buffer, stream and invalid integers
+	for (; i < count; ++i) {
+		values[i] = ReadInt();
+	}
+}
+
 uint64_t LcfReader::ReadUInt64() {
+	if (data && data_size - static_cast<size_t>(offset) >= 8) {
+		uint64_t value;
+		const size_t len = DecodeCompressedInt(data + offset, value);
+		if (len > 0) {
+			offset += len;
+			return value;
+		}
+	}
+
 	uint64_t value = 0;
 	unsigned char temp = 0;
 	int loops = 0;
@@ -138,36 +339,26 @@ void LcfReader::Read<double>(double& ref) {
 
 template <>
 void LcfReader::Read<bool>(std::vector<bool>& buffer, size_t size) {
-	buffer.clear();
-
-	for (unsigned i = 0; i < size; ++i) {
-		uint8_t val;
-		Read(&val, 1, 1);
-		buffer.push_back(val > 0);
-	}
+	const auto* p = reinterpret_cast<const uint8_t*>(ReadView(size));
+	buffer.assign(p, p + size);
 }
 
 template <>
 void LcfReader::Read<uint8_t>(std::vector<uint8_t>& buffer, size_t size) {
 	buffer.clear();
-
-	for (unsigned int i = 0; i < size; ++i) {
-		uint8_t val;
-		Read(&val, 1, 1);
-		buffer.push_back(val);
-	}
+	buffer.resize(size);
+	Read(buffer.data(), 1, size);
 }
 
 template <>
 void LcfReader::Read<int16_t>(std::vector<int16_t>& buffer, size_t size) {
 	buffer.clear();
 	size_t items = size / 2;
-	for (unsigned int i = 0; i < items; ++i) {
-		int16_t val;
-		Read(&val, 2, 1);
-		SwapByteOrder(val);
-		buffer.push_back(val);
-	}
+	buffer.resize(items);
+	Read(buffer.data(), 2, items);
+#ifdef WORDS_BIGENDIAN
+	SwapByteOrder16(reinterpret_cast<uint16_t*>(buffer.data()), items);
+#endif
 	if (size % 2 != 0) {
 		Seek(1, FromCurrent);
 		buffer.push_back(0);
@@ -178,12 +369,11 @@ template <>
 void LcfReader::Read<int32_t>(std::vector<int32_t>& buffer, size_t size) {
 	buffer.clear();
 	size_t items = size / 4;
-	for (unsigned int i = 0; i < items; ++i) {
-		int32_t val;
-		Read(&val, 4, 1);
-		SwapByteOrder(val);
-		buffer.push_back(val);
-	}
+	buffer.resize(items);
+	Read(buffer.data(), 4, items);
+#ifdef WORDS_BIGENDIAN
+	SwapByteOrder32(reinterpret_cast<uint32_t*>(buffer.data()), items);
+#endif
 	if (size % 4 != 0) {
 		Seek(size % 4, FromCurrent);
 		buffer.push_back(0);
@@ -194,12 +384,11 @@ template <>
 void LcfReader::Read<uint32_t>(std::vector<uint32_t>& buffer, size_t size) {
 	buffer.clear();
 	size_t items = size / 4;
-	for (unsigned int i = 0; i < items; ++i) {
-		uint32_t val;
-		Read(&val, 4, 1);
-		SwapByteOrder(val);
-		buffer.push_back(val);
-	}
+	buffer.resize(items);
+	Read(buffer.data(), 4, items);
+#ifdef WORDS_BIGENDIAN
+	SwapByteOrder32(buffer.data(), items);
+#endif
 	if (size % 4 != 0) {
 		Seek(size % 4, FromCurrent);
 		buffer.push_back(0);
@@ -208,11 +397,19 @@ void LcfReader::Read<uint32_t>(std::vector<uint32_t>& buffer, size_t size) {
 
 void LcfReader::ReadBits(DBBitArray& buffer, size_t size) {
 	buffer = DBBitArray(size);
-	for (size_t i = 0; i < size; ++i) {
-		uint8_t val;
-		Read(&val, sizeof(val), 1);
-		buffer[i] = static_cast<bool>(val);
+	PackBits(reinterpret_cast<const uint8_t*>(ReadView(size)), size, buffer.bytes());
+}
+
+const char* LcfReader::ReadView(size_t size) {
+	if (!stream && size <= data_size - static_cast<size_t>(offset)) {
+		const auto* p = reinterpret_cast<const char*>(data) + offset;
+		offset += size;
+		return p;
 	}
+	auto& tmp = StrBuffer();
+	tmp.assign(size, '\0');
+	Read((size > 0 ? &tmp.front(): nullptr), 1, size);
+	return tmp.data();
 }
 
 void LcfReader::ReadString(std::string& ref, size_t size) {
@@ -222,41 +419,99 @@ void LcfReader::ReadString(std::string& ref, size_t size) {
 }
 
 void LcfReader::ReadString(DBString& ref, size_t size) {
-	auto& tmp = StrBuffer();
-	ReadString(tmp, size);
-	ref = DBString(tmp);
+	// Transcode straight out of the buffer
+	const auto src = std::string_view(ReadView(size), size);
+	if (auto* pool = DBStringPool::Current()) {
+		// Most names are short, avoid a heap buffer for them
+		char small[256];
+		std::string large;
+		const auto bound = encoder.EncodeSizeBound(src);
+		char* dst = small;
+		if (bound > sizeof(small)) {
+			large.resize(bound);
+			dst = &large.front();
+		}
+		ref = pool->Intern(std::string_view(dst, encoder.Encode(src, dst)));
+		return;
+	}
+	ref = DBString::Create(encoder.EncodeSizeBound(src), [&](char* dst) {
+		return encoder.Encode(src, dst);
+	});
 }
 
 bool LcfReader::IsOk() const {
-	return stream.good() && encoder.IsOk();
+	if (!stream) {
+		return !data_eof && encoder.IsOk();
+	}
+	return stream->good() && encoder.IsOk();
 }
 
 bool LcfReader::Eof() const {
-	return stream.eof();
+	if (!stream) {
+		return data_eof;
+	}
+	return stream->eof();
+}
+
+void LcfReader::Clear() {
+	if (!stream) {
+		data_eof = false;
+		return;
+	}
+	stream->clear();
 }
 
 void LcfReader::Seek(size_t pos, SeekMode mode) {
+	if (!stream) {
+		// Seeking out of the buffer clamps to the end and behaves like a
+		// failed read. Like seekg with the failbit set a failed reader does
+		// not move until Clear(), so all further reads fail.
+		if (data_eof) {
+			return;
+		}
+		size_t target = 0;
+		switch (mode) {
+		case LcfReader::FromStart:
+			target = pos;
+			break;
+		case LcfReader::FromCurrent:
+			target = static_cast<size_t>(offset) + pos;
+			break;
+		case LcfReader::FromEnd:
+			target = data_size + pos;
+			break;
+		default:
+			assert(false && "Invalid SeekMode");
+		}
+		if (target > data_size) {
+			target = data_size;
+			data_eof = true;
+		}
+		offset = target;
+		return;
+	}
+
 	constexpr auto fast_seek_size = 32;
 	switch (mode) {
 	case LcfReader::FromStart:
-		stream.seekg(pos, std::ios_base::beg);
-		offset = stream.tellg();
+		stream->seekg(pos, std::ios_base::beg);
+		offset = stream->tellg();
 		break;
 	case LcfReader::FromCurrent:
 		if (pos <= fast_seek_size) {
 			// seekg() always results in a system call which is slow.
 			// For small values just read and throwaway.
 			char buf[fast_seek_size];
-			stream.read(buf, pos);
-			offset += stream.gcount();
+			stream->read(buf, pos);
+			offset += stream->gcount();
 		} else {
-			stream.seekg(pos, std::ios_base::cur);
-			offset = stream.tellg();
+			stream->seekg(pos, std::ios_base::cur);
+			offset = stream->tellg();
 		}
 		break;
 	case LcfReader::FromEnd:
-		stream.seekg(pos, std::ios_base::end);
-		offset = stream.tellg();
+		stream->seekg(pos, std::ios_base::end);
+		offset = stream->tellg();
 		break;
 	default:
 		assert(false && "Invalid SeekMode");
@@ -275,7 +530,14 @@ uint32_t LcfReader::Tell() {
 }
 
 int LcfReader::Peek() {
-	return stream.peek();
+	if (!stream) {
+		if (static_cast<size_t>(offset) >= data_size) {
+			data_eof = true;
+			return EOF;
+		}
+		return data[offset];
+	}
+	return stream->peek();
 }
 
 void LcfReader::Skip(const struct LcfReader::Chunk& chunk_info, const char* where) {
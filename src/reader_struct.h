@@ -15,10 +15,10 @@
 #endif
 #include <string>
 #include <vector>
-#include <map>
 #include <cstring>
 #include <cstdlib>
 #include <cinttypes>
+#include "lcf/chunk_visitor.h"
 #include "lcf/dbstring.h"
 #include "lcf/reader_lcf.h"
 #include "lcf/writer_lcf.h"
@@ -293,7 +293,7 @@ struct Primitive<std::string> {
 		stream.Write(ref);
 	}
 	static int LcfSize(const std::string& ref, LcfWriter& stream) {
-		return stream.Decode(ref).size();
+		return stream.DecodeBuffered(ref).size();
 	}
 	static void WriteXml(const std::string& ref, XmlWriter& stream) {
 		stream.Write(ref);
@@ -360,6 +360,81 @@ struct TypeReader<T, Category::Primitive> {
 	}
 };
 
+/**
+ * Chunk visitor helpers, see ChunkVisitor.
+ */
+namespace ChunkWalk {
+	/**
+	 * Reads a compressed integer and advances data past it.
+	 *
+	 * @return false when data ends before the integer does.
+	 */
+	bool ReadInt(Span<const uint8_t>& data, int32_t& value);
+}
+
+/**
+ * Decodes the value of primitive chunks for the visitor.
+ * Arrays are only reported as bytes.
+ */
+template <class T>
+struct PrimitiveVisitor {
+	static void Visit(const ChunkVisitor::Chunk& /* chunk */, ChunkVisitor& /* visitor */) {}
+};
+
+template <> void PrimitiveVisitor<bool>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+template <> void PrimitiveVisitor<int8_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+template <> void PrimitiveVisitor<uint8_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+template <> void PrimitiveVisitor<int16_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+template <> void PrimitiveVisitor<uint32_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+template <> void PrimitiveVisitor<int32_t>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+template <> void PrimitiveVisitor<double>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+template <> void PrimitiveVisitor<std::string>::Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor);
+
+/**
+ * Reports the contents of a chunk to the visitor.
+ * Raw structs and flags are only reported as bytes.
+ *
+ * @return false when the chunk is corrupted.
+ */
+template <class T, Category::Index cat = TypeCategory<T>::value>
+struct TypeVisitor {
+	static bool Visit(const ChunkVisitor::Chunk& /* chunk */, ChunkVisitor& /* visitor */) {
+		return true;
+	}
+};
+
+template <class T>
+struct TypeVisitor<T, Category::Primitive> {
+	static bool Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+		PrimitiveVisitor<T>::Visit(chunk, visitor);
+		return true;
+	}
+};
+
+template <>
+struct TypeVisitor<DBString, Category::RawStruct> {
+	static bool Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+		PrimitiveVisitor<std::string>::Visit(chunk, visitor);
+		return true;
+	}
+};
+
+template <class T>
+struct TypeVisitor<T, Category::Struct> {
+	static bool Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+		auto data = chunk.data;
+		return Struct<T>::VisitLcf(data, 0, chunk.depth + 1, visitor);
+	}
+};
+
+template <class T>
+struct TypeVisitor<std::vector<T>, Category::Struct> {
+	static bool Visit(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) {
+		auto data = chunk.data;
+		return Struct<T>::VisitLcfArray(data, chunk.depth + 1, visitor);
+	}
+};
+
 /**
  * Field abstract base class template.
  */
@@ -379,6 +454,8 @@ struct Field {
 	virtual void WriteXml(const S& obj, XmlWriter& stream) const = 0;
 	virtual void BeginXml(S& obj, XmlReader& stream) const = 0;
 	virtual void ParseXml(S& obj, const std::string& data) const = 0;
+	/** Reports the contents of a chunk of this field, see TypeVisitor. */
+	virtual bool VisitLcf(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) const = 0;
 
 	bool isPresentIfDefault(bool db_is2k3) const {
 		if (std::is_same<S,rpg::Terms>::value && db_is2k3 && (id == 0x3 || id == 0x1)) {
@@ -420,6 +497,9 @@ struct TypedField : public Field<S> {
 	void ParseXml(S& obj, const std::string& data) const {
 		TypeReader<T>::ParseXml(obj.*ref, data);
 	}
+	bool VisitLcf(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) const {
+		return TypeVisitor<T>::Visit(chunk, visitor);
+	}
 	bool IsDefault(const S& a, const S& b, bool) const {
 		return a.*ref == b.*ref;
 	}
@@ -437,6 +517,13 @@ struct DatabaseVersionField : public TypedField<S,T> {
 
 	using TypedField<S,T>::TypedField;
 
+	void WriteLcf(const S& obj, LcfWriter& stream) const {
+		//If db version is 0, it's like a "version block" is not present.
+		if ((obj.*(this->ref)) == 0) {
+			return;
+		}
+		TypedField<S,T>::WriteLcf(obj, stream);
+	}
 	int LcfSize(const S& obj, LcfWriter& stream) const {
 		//If db version is 0, it's like a "version block" is not present.
 		if ((obj.*(this->ref)) == 0) {
@@ -472,6 +559,9 @@ struct EmptyField : public Field<S> {
 	void WriteXml(const S& /* obj */, XmlWriter& /* stream */) const { }
 	void BeginXml(S& /* obj */, XmlReader& /* stream */) const { }
 	void ParseXml(S& /* obj */, const std::string& /* data */) const { }
+	bool VisitLcf(const ChunkVisitor::Chunk& /* chunk */, ChunkVisitor& /* visitor */) const {
+		return true;
+	}
 
 	bool IsDefault(const S& /* a */, const S& /* b */, bool) const {
 		return true;
@@ -509,6 +599,9 @@ struct SizeField : public Field<S> {
 	void ParseXml(S& /* obj */, const std::string& /* data */) const {
 		// no-op
 	}
+	bool VisitLcf(const ChunkVisitor::Chunk& chunk, ChunkVisitor& visitor) const {
+		return TypeVisitor<int32_t>::Visit(chunk, visitor);
+	}
 	bool IsDefault(const S& a, const S& b, bool) const {
 		return (a.*ref).size() == (b.*ref).size();
 	}
@@ -592,27 +685,57 @@ struct IDReaderT<S, false> {
 	static void ReadIDXml(S& /* obj */, const char** /* atts */) {}
 };
 
-struct StringComparator {
-	bool operator() (const char* const& lhs, const char* const& rhs) const {
-		return strcmp(lhs, rhs) < 0;
+/**
+ * Hash of XML tag names used by the generated tag tables.
+ * Must match tag_hash in generator/generate.py.
+ */
+inline uint32_t TagHash(const char* name, uint32_t seed) {
+	uint32_t h = seed;
+	for (; *name != '\0'; ++name) {
+		h = (h ^ static_cast<uint8_t>(*name)) * 16777619u;
 	}
-};
+	return h ^ (h >> 15);
+}
+
+/** Seed of the bucket hash of the tag tables, see tag_hash_base in generate.py. */
+constexpr uint32_t tag_hash_base = 0x811C9DC5u;
 
 // Struct class template
 
 template <class S>
 class Struct {
 private:
-	typedef std::map<int, const Field<S>* > field_map_type;
-	typedef std::map<const char* const, const Field<S>*, StringComparator> tag_map_type;
 	typedef IDReaderT<S, IDChecker<S>::value > IDReader;
 	static const Field<S>* fields[];
-	static field_map_type field_map;
-	static tag_map_type tag_map;
+	/** Fields directly indexed by chunk ID, covers the dense range of low IDs. */
+	static const Field<S>* const field_table[];
+	static const uint32_t field_table_size;
+	/** Fields with IDs outside of field_table, sorted by ID and NULL terminated. */
+	static const Field<S>* const sparse_fields[];
+	static const uint32_t sparse_fields_size;
+	/**
+	 * Perfect hash of the field names: the bucket of a name selects the seed
+	 * of its slot in tag_table. Both have tag_table_size entries.
+	 */
+	static const uint32_t tag_seeds[];
+	static const Field<S>* const tag_table[];
+	static const uint32_t tag_table_size;
 	static const char* const name;
 
-	static void MakeFieldMap();
-	static void MakeTagMap();
+	static const Field<S>* FindField(uint32_t id);
+	/** @return the field with the XML tag name or NULL when there is none. */
+	static const Field<S>* FindTag(const char* name);
+
+	/**
+	 * Reads a chunk through the generated field dispatch.
+	 *
+	 * @return the field of the chunk or NULL when the chunk is unknown.
+	 */
+	static const Field<S>* ReadChunk(S& obj, LcfReader& stream, const LcfReader::Chunk& chunk_info);
+	/** Writes all chunks of obj that differ from ref through the generated field dispatch. */
+	static void WriteChunks(const S& obj, const S& ref, LcfWriter& stream);
+	/** @return the size of all chunks written by WriteChunks. */
+	static int ChunksSize(const S& obj, const S& ref, LcfWriter& stream);
 
 	template <class T> friend class StructXmlHandler;
 	template <class T> friend class StructVectorXmlHandler;
@@ -620,24 +743,36 @@ private:
 
 public:
 	static void ReadLcf(S& obj, LcfReader& stream);
+	/**
+	 * Reads the body of a single chunk whose header was already consumed.
+	 * Unknown chunks are skipped.
+	 */
+	static void ReadLcfChunk(S& obj, LcfReader& stream, const LcfReader::Chunk& chunk_info);
 	static void WriteLcf(const S& obj, LcfWriter& stream);
 	static int LcfSize(const S& obj, LcfWriter& stream);
 	static void WriteXml(const S& obj, XmlWriter& stream);
 	static void BeginXml(S& obj, XmlReader& stream);
 
+	/**
+	 * Walks the chunks of a struct without reading it, see ChunkVisitor.
+	 *
+	 * @param data struct data, advanced past the struct.
+	 * @param id ID passed to the visitor.
+	 * @param depth nesting level of the chunks.
+	 * @param visitor visitor.
+	 * @return false when the data is corrupted.
+	 */
+	static bool VisitLcf(Span<const uint8_t>& data, int32_t id, int depth, ChunkVisitor& visitor);
+
 	static void ReadLcf(std::vector<S>& obj, LcfReader& stream);
 	static void WriteLcf(const std::vector<S>& obj, LcfWriter& stream);
 	static int LcfSize(const std::vector<S>& obj, LcfWriter& stream);
 	static void WriteXml(const std::vector<S>& obj, XmlWriter& stream);
 	static void BeginXml(std::vector<S>& obj, XmlReader& stream);
+	/** Walks the chunks of an array of structs, see VisitLcf. */
+	static bool VisitLcfArray(Span<const uint8_t>& data, int depth, ChunkVisitor& visitor);
 };
 
-template <class S>
-std::map<int, const Field<S>* > Struct<S>::field_map;
-
-template <class S>
-std::map<const char* const, const Field<S>*, StringComparator> Struct<S>::tag_map;
-
 /**
  * Struct reader.
 */
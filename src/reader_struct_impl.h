@@ -7,6 +7,7 @@
  * file that was distributed with this source code.
  */
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
@@ -24,19 +25,27 @@ namespace lcf {
 // Read/Write Struct
 
 template <class S>
-void Struct<S>::MakeFieldMap() {
-	if (!field_map.empty())
-		return;
-	for (int i = 0; fields[i] != NULL; i++)
-		field_map[fields[i]->id] = fields[i];
+inline const Field<S>* Struct<S>::FindField(uint32_t id) {
+	if (id < field_table_size) {
+		return field_table[id];
+	}
+	const auto last = sparse_fields + sparse_fields_size;
+	const auto it = std::lower_bound(sparse_fields, last, id,
+			[](const Field<S>* field, uint32_t id) { return static_cast<uint32_t>(field->id) < id; });
+	if (it != last && static_cast<uint32_t>((*it)->id) == id) {
+		return *it;
+	}
+	return NULL;
 }
 
 template <class S>
-void Struct<S>::MakeTagMap() {
-	if (!tag_map.empty())
-		return;
-	for (int i = 0; fields[i] != NULL; i++)
-		tag_map[fields[i]->name] = fields[i];
+const Field<S>* Struct<S>::FindTag(const char* name) {
+	const auto seed = tag_seeds[TagHash(name, tag_hash_base) & (tag_table_size - 1)];
+	const Field<S>* field = tag_table[TagHash(name, seed) & (tag_table_size - 1)];
+	if (field != NULL && strcmp(field->name, name) == 0) {
+		return field;
+	}
+	return NULL;
 }
 
 template <typename T>
@@ -57,10 +66,42 @@ struct StructDefault<rpg::Actor> {
 
 
 
+/**
+ * Writes a single chunk of a struct.
+ * Used by the generated WriteChunks, the qualified calls bypass the vtable.
+ */
+template <class S, class F>
+inline void WriteChunk(const F& field, const S& obj, const S& ref, LcfWriter& stream, bool db_is2k3) {
+	if (!db_is2k3 && field.is2k3 && !stream.Writes2k3Fields()) {
+		return;
+	}
+	if (!field.isPresentIfDefault(db_is2k3) && field.F::IsDefault(obj, ref, db_is2k3)) {
+		return;
+	}
+	stream.WriteInt(field.id);
+	const auto chunk = stream.BeginChunk();
+	field.F::WriteLcf(obj, stream);
+	stream.EndChunk(chunk);
+}
+
+/**
+ * Calculates the size of a single chunk of a struct.
+ * Used by the generated ChunksSize.
+ */
+template <class S, class F>
+inline int ChunkSize(const F& field, const S& obj, const S& ref, LcfWriter& stream, bool db_is2k3) {
+	if (!db_is2k3 && field.is2k3 && !stream.Writes2k3Fields()) {
+		return 0;
+	}
+	if (!field.isPresentIfDefault(db_is2k3) && field.F::IsDefault(obj, ref, db_is2k3)) {
+		return 0;
+	}
+	int size = field.F::LcfSize(obj, stream);
+	return LcfReader::IntSize(field.id) + LcfReader::IntSize(size) + size;
+}
+
 template <class S>
 void Struct<S>::ReadLcf(S& obj, LcfReader& stream) {
-	MakeFieldMap();
-
 	LcfReader::Chunk chunk_info;
 
 	while (!stream.Eof()) {
@@ -70,24 +111,99 @@ void Struct<S>::ReadLcf(S& obj, LcfReader& stream) {
 
 		chunk_info.length = stream.ReadInt();
 
-		auto it = field_map.find(chunk_info.ID);
-		if (it != field_map.end()) {
+		ReadLcfChunk(obj, stream, chunk_info);
+	}
+}
+
+template <class S>
+void Struct<S>::ReadLcfChunk(S& obj, LcfReader& stream, const LcfReader::Chunk& chunk_info) {
 #ifdef LCF_DEBUG_TRACE
-			fprintf(stderr, "0x%02x (size: %" PRIu32 ", pos: 0x%" PRIx32 "): %s\n", chunk_info.ID, chunk_info.length, stream.Tell(), it->second->name);
+	if (const Field<S>* field = FindField(chunk_info.ID)) {
+		fprintf(stderr, "0x%02x (size: %" PRIu32 ", pos: 0x%" PRIx32 "): %s\n", chunk_info.ID, chunk_info.length, stream.Tell(), field->name);
+	}
 #endif
-			const uint32_t off = stream.Tell();
-			it->second->ReadLcf(obj, stream, chunk_info.length);
-			const uint32_t bytes_read = stream.Tell() - off;
-			if (bytes_read != chunk_info.length) {
-				Log::Warning("%s: Corrupted Chunk 0x%02" PRIx32 " (size: %" PRIu32 ", pos: 0x%" PRIx32 "): %s : Read %" PRIu32 " bytes!",
-						Struct<S>::name, chunk_info.ID, chunk_info.length, off, it->second->name, bytes_read);
-				stream.Seek(off + chunk_info.length);
+	const uint32_t off = stream.Tell();
+	const Field<S>* field = ReadChunk(obj, stream, chunk_info);
+	if (field != NULL) {
+		const uint32_t bytes_read = stream.Tell() - off;
+		if (bytes_read != chunk_info.length) {
+			Log::Warning("%s: Corrupted Chunk 0x%02" PRIx32 " (size: %" PRIu32 ", pos: 0x%" PRIx32 "): %s : Read %" PRIu32 " bytes!",
+					Struct<S>::name, chunk_info.ID, chunk_info.length, off, field->name, bytes_read);
+			stream.Seek(off + chunk_info.length);
+		}
+	}
+	else {
+		stream.Skip(chunk_info, Struct<S>::name);
+	}
+}
+
+template <class S>
+bool Struct<S>::VisitLcf(Span<const uint8_t>& data, int32_t id, int depth, ChunkVisitor& visitor) {
+	const bool visit = visitor.BeginStruct(name, id, depth);
+
+	ChunkVisitor::Chunk chunk;
+	chunk.struct_name = name;
+	chunk.depth = depth;
+	while (!data.empty()) {
+		int32_t chunk_id;
+		int32_t length;
+		if (!ChunkWalk::ReadInt(data, chunk_id)) {
+			Log::Warning("%s: Truncated chunk", name);
+			return false;
+		}
+		if (chunk_id == 0) {
+			break;
+		}
+		if (!ChunkWalk::ReadInt(data, length) || static_cast<uint32_t>(length) > data.size()) {
+			Log::Warning("%s: Chunk 0x%02" PRIx32 " exceeds the data", name, static_cast<uint32_t>(chunk_id));
+			return false;
+		}
+
+		chunk.id = static_cast<uint32_t>(chunk_id);
+		chunk.data = data.first(static_cast<uint32_t>(length));
+		data = data.subspan(static_cast<uint32_t>(length));
+		if (!visit) {
+			// Only the end of the struct is needed
+			continue;
+		}
+
+		const Field<S>* field = FindField(chunk.id);
+		chunk.field_name = field != NULL ? field->name : nullptr;
+		if (visitor.BeginChunk(chunk)) {
+			if (field != NULL && !field->VisitLcf(chunk, visitor)) {
+				return false;
 			}
+			visitor.EndChunk(chunk);
 		}
-		else {
-			stream.Skip(chunk_info, Struct<S>::name);
+	}
+
+	if (visit) {
+		visitor.EndStruct(name, id, depth);
+	}
+	return true;
+}
+
+template <class S>
+bool Struct<S>::VisitLcfArray(Span<const uint8_t>& data, int depth, ChunkVisitor& visitor) {
+	int32_t count;
+	if (!ChunkWalk::ReadInt(data, count) || count < 0) {
+		Log::Warning("%s: Invalid array size", name);
+		return false;
+	}
+	for (int32_t i = 0; i < count; i++) {
+		if (data.empty()) {
+			Log::Warning("%s: Array ends after %" PRId32 " of %" PRId32 " elements", name, i, count);
+			return false;
+		}
+		int32_t id = 0;
+		if (IDChecker<S>::value && !ChunkWalk::ReadInt(data, id)) {
+			return false;
+		}
+		if (!VisitLcf(data, id, depth, visitor)) {
+			return false;
 		}
 	}
+	return true;
 }
 
 template<typename T>
@@ -106,55 +222,16 @@ conditional_zero_writer(LcfWriter& stream) {
 
 template <class S>
 void Struct<S>::WriteLcf(const S& obj, LcfWriter& stream) {
-	const bool db_is2k3 = stream.Is2k3();
-
-	auto ref = StructDefault<S>::make(db_is2k3);
-	int last = -1;
-	for (int i = 0; fields[i] != NULL; i++) {
-		const Field<S>* field = fields[i];
-		if (!db_is2k3 && field->is2k3) {
-			continue;
-		}
-		if (field->id < last)
-			std::cerr << "field order mismatch: " << field->id
-					  << " after " << last
-					  << " in struct " << name
-					  << std::endl;
-		if (!field->isPresentIfDefault(db_is2k3) && field->IsDefault(obj, ref, db_is2k3)) {
-			continue;
-		}
-		stream.WriteInt(field->id);
-		auto len = field->LcfSize(obj, stream);
-		stream.WriteInt(len);
-		if (len > 0) {
-			field->WriteLcf(obj, stream);
-		}
-	}
+	const auto ref = StructDefault<S>::make(stream.Is2k3());
+	WriteChunks(obj, ref, stream);
 	// Writing a 0-byte after rpg::Database or rpg::Save breaks the parser in RPG_RT
 	conditional_zero_writer<S>(stream);
 }
 
 template <class S>
 int Struct<S>::LcfSize(const S& obj, LcfWriter& stream) {
-	const bool db_is2k3 = stream.Is2k3();
-	int result = 0;
-	auto ref = StructDefault<S>::make(db_is2k3);
-	for (int i = 0; fields[i] != NULL; i++) {
-		const Field<S>* field = fields[i];
-		if (!db_is2k3 && field->is2k3) {
-			continue;
-		}
-		//printf("%s\n", field->name);
-		if (!field->isPresentIfDefault(db_is2k3) && field->IsDefault(obj, ref, db_is2k3)) {
-			continue;
-		}
-		result += LcfReader::IntSize(field->id);
-		int size = field->LcfSize(obj, stream);
-		result += LcfReader::IntSize(size);
-		result += size;
-	}
-	result += LcfReader::IntSize(0);
-	return result;
+	const auto ref = StructDefault<S>::make(stream.Is2k3());
+	return ChunksSize(obj, ref, stream) + LcfReader::IntSize(0);
 }
 
 template <class S>
@@ -170,12 +247,16 @@ void Struct<S>::WriteXml(const S& obj, XmlWriter& stream) {
 template <class S>
 class StructXmlHandler : public XmlHandler {
 public:
-	StructXmlHandler(S& ref) : ref(ref), field(NULL) {
-		Struct<S>::MakeTagMap();
-	}
+	StructXmlHandler(S& ref) : ref(ref), field(NULL) {}
 
 	void StartElement(XmlReader& stream, const char* name, const char** /* atts */) {
-		field = Struct<S>::tag_map[name];
+		field = Struct<S>::FindTag(name);
+		if (field == NULL) {
+			Log::Warning("XML: Unrecognized field '%s' in %s", name, Struct<S>::name);
+			// The base handler ignores the whole element including children
+			stream.SetHandler(new XmlHandler());
+			return;
+		}
 		field->BeginXml(ref, stream);
 	}
 
@@ -261,8 +342,7 @@ public:
 	void StartElement(XmlReader& stream, const char* name, const char** atts) {
 		if (strcmp(name, Struct<S>::name) != 0)
 			Log::Error("XML: Expecting %s but got %s", Struct<S>::name, name);
-		ref.resize(ref.size() + 1);
-		S& obj = ref.back();
+		S& obj = ref.emplace_back();
 		Struct<S>::IDReader::ReadIDXml(obj, atts);
 		stream.SetHandler(new StructXmlHandler<S>(obj));
 	}
@@ -7,11 +7,17 @@
  * file that was distributed with this source code.
  */
 
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <new>
 #include <sstream>
+#include <type_traits>
 #include <cstdarg>
 #include "lcf/reader_lcf.h"
 #include "lcf/reader_xml.h"
 #include "lcf/dbstring.h"
+#include "lcf/dbstringpool.h"
 #include "log.h"
 
 // Expat callbacks
@@ -33,10 +39,22 @@ static void CharacterDataHandler(void* closure, const XML_Char* s, int len) {
 
 namespace lcf {
 
-XmlReader::XmlReader(std::istream& filestream) :
-	stream(filestream),
+XmlReader::XmlReader(std::istream& filestream, size_t chunk_size) :
+	stream(&filestream),
+	chunk_size(chunk_size > 0 ? std::min<size_t>(chunk_size, std::numeric_limits<int>::max()) : default_chunk_size),
 	parser(NULL)
 {
+	Init();
+}
+
+XmlReader::XmlReader(Span<const uint8_t> buffer) :
+	data(buffer),
+	parser(NULL)
+{
+	Init();
+}
+
+void XmlReader::Init() {
 #if LCF_SUPPORT_XML
 	parser = XML_ParserCreate("UTF-8");
 
@@ -57,15 +75,32 @@ XmlReader::~XmlReader() {
 }
 
 bool XmlReader::IsOk() const {
-	return (stream.good() && parser != NULL);
+	return ((stream == nullptr || stream->good()) && parser != NULL);
 }
 
 void XmlReader::Parse() {
 #if LCF_SUPPORT_XML
-	static const int bufsize = 4096;
-	while (IsOk() && !stream.eof()) {
-		void* buffer = XML_GetBuffer(parser, bufsize);
-		int len = stream.read(reinterpret_cast<char*>(buffer),bufsize).gcount();
+	if (stream == nullptr) {
+		// The whole document is passed at once, expat parses it in place
+		// instead of copying it into its own buffer
+		constexpr size_t max_len = std::numeric_limits<int>::max();
+		const char* p = reinterpret_cast<const char*>(data.data());
+		size_t left = data.size();
+		do {
+			const size_t len = std::min(left, max_len);
+			left -= len;
+			if (XML_Parse(parser, p, static_cast<int>(len), left == 0) == XML_STATUS_ERROR) {
+				Log::Error("XML: %s", XML_ErrorString(XML_GetErrorCode(parser)));
+				break;
+			}
+			p += len;
+		} while (left > 0);
+		return;
+	}
+
+	while (IsOk() && !stream->eof()) {
+		void* buffer = XML_GetBuffer(parser, static_cast<int>(chunk_size));
+		int len = stream->read(reinterpret_cast<char*>(buffer), chunk_size).gcount();
 		int result = XML_ParseBuffer(parser, len, len <= 0);
 		if (result == 0)
 			Log::Error("XML: %s", XML_ErrorString(XML_GetErrorCode(parser)));
@@ -97,54 +132,223 @@ void XmlReader::EndElement(const char* name) {
 	handlers.back()->EndElement(*this, name);
 }
 
+namespace {
+
+/** Handler sizes are rounded up to multiples of this */
+constexpr std::size_t handler_granularity = 16;
+/** Larger handlers are not recycled */
+constexpr std::size_t handler_size_classes = 8;
+
+/**
+ * Free lists of handler memory, one per size class. Handlers only live
+ * while their element is open, so the lists stay as short as the deepest
+ * nesting of the documents.
+ */
+struct HandlerFreeList {
+	struct Block {
+		Block* next;
+	};
+
+	Block* heads[handler_size_classes] = {};
+
+	~HandlerFreeList() {
+		for (auto* head: heads) {
+			while (head != nullptr) {
+				auto* next = head->next;
+				::operator delete(head);
+				head = next;
+			}
+		}
+	}
+};
+
+thread_local HandlerFreeList handler_free_list;
+
+} // namespace
+
+void* XmlHandler::operator new(std::size_t size) {
+	const std::size_t size_class = (size - 1) / handler_granularity;
+	if (size_class >= handler_size_classes) {
+		return ::operator new(size);
+	}
+
+	auto& head = handler_free_list.heads[size_class];
+	if (head != nullptr) {
+		auto* block = head;
+		head = block->next;
+		return block;
+	}
+	return ::operator new((size_class + 1) * handler_granularity);
+}
+
+void XmlHandler::operator delete(void* ptr, std::size_t size) noexcept {
+	if (ptr == nullptr) {
+		return;
+	}
+	const std::size_t size_class = (size - 1) / handler_granularity;
+	if (size_class >= handler_size_classes) {
+		::operator delete(ptr);
+		return;
+	}
+
+	auto& head = handler_free_list.heads[size_class];
+	head = new (ptr) HandlerFreeList::Block{ head };
+}
+
 // Primitive type readers
 
+namespace {
+
+/** Same set of characters as isspace in the C locale */
+bool IsSpace(char c) {
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * Finds the next whitespace separated token.
+ *
+ * @param p position to search from, set to the end of the token.
+ * @param end end of the data.
+ * @param token set to the start of the token.
+ * @return false when there are no more tokens.
+ */
+bool NextToken(const char*& p, const char* end, const char*& token) {
+	while (p != end && IsSpace(*p)) {
+		++p;
+	}
+	if (p == end) {
+		return false;
+	}
+	token = p;
+	while (p != end && !IsSpace(*p)) {
+		++p;
+	}
+	return true;
+}
+
+size_t CountTokens(const std::string& data) {
+	const char* p = data.data();
+	const char* const end = p + data.size();
+	const char* token;
+	size_t count = 0;
+	while (NextToken(p, end, token)) {
+		++count;
+	}
+	return count;
+}
+
+/**
+ * Parses an integer like operator>> of streams: a leading '+' is allowed,
+ * values out of range are clamped and invalid input yields 0. Unsigned
+ * types accept a leading '-' and wrap around like strtoul.
+ */
+template <typename T>
+void ParseInteger(const char* first, const char* last, T& val) {
+	bool negate = false;
+	if (first != last && *first == '+') {
+		++first;
+	} else if (std::is_unsigned<T>::value && first != last && *first == '-') {
+		++first;
+		negate = true;
+	}
+	val = 0;
+	if (std::from_chars(first, last, val).ec == std::errc::result_out_of_range) {
+		val = *first == '-' ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+	} else if (negate) {
+		val = static_cast<T>(T(0) - val);
+	}
+}
+
+void ParseToken(const char* first, const char* last, bool& val) {
+	val = last - first == 1 && *first == 'T';
+}
+
+void ParseToken(const char* first, const char* last, int8_t& val) {
+	int x;
+	ParseInteger(first, last, x);
+	val = static_cast<int8_t>(x);
+}
+
+void ParseToken(const char* first, const char* last, uint8_t& val) {
+	int x;
+	ParseInteger(first, last, x);
+	val = static_cast<uint8_t>(x);
+}
+
+void ParseToken(const char* first, const char* last, int16_t& val) {
+	ParseInteger(first, last, val);
+}
+
+void ParseToken(const char* first, const char* last, int32_t& val) {
+	ParseInteger(first, last, val);
+}
+
+void ParseToken(const char* first, const char* last, uint32_t& val) {
+	ParseInteger(first, last, val);
+}
+
+void ParseToken(const char* first, const char* last, double& val) {
+	val = 0;
+#ifdef __cpp_lib_to_chars
+	if (first != last && *first == '+') {
+		++first;
+	}
+	std::from_chars(first, last, val);
+#else
+	// No floating point from_chars in this standard library
+	std::istringstream s(std::string(first, last));
+	s.imbue(std::locale::classic());
+	s >> val;
+#endif
+}
+
+/** Parses the first token of data, values without a token are 0 */
+template <typename T>
+void ReadToken(T& val, const std::string& data) {
+	const char* p = data.data();
+	const char* token;
+	if (NextToken(p, p + data.size(), token)) {
+		ParseToken(token, p, val);
+	} else {
+		val = T();
+	}
+}
+
+} // namespace
+
 template <>
 void XmlReader::Read<bool>(bool& val, const std::string& data) {
-	std::istringstream s(data);
-	std::string str;
-	s >> str;
-	val = str == "T";
+	ReadToken(val, data);
 }
 
 template <>
 void XmlReader::Read<int32_t>(int32_t& val, const std::string& data) {
-	std::istringstream s(data);
-	s >> val;
+	ReadToken(val, data);
 }
 
 template <>
 void XmlReader::Read<int8_t>(int8_t& val, const std::string& data) {
-	std::istringstream s(data);
-	int x;
-	s >> x;
-	val = x;
+	ReadToken(val, data);
 }
 
 template <>
 void XmlReader::Read<uint8_t>(uint8_t& val, const std::string& data) {
-	std::istringstream s(data);
-	int x;
-	s >> x;
-	val = x;
+	ReadToken(val, data);
 }
 
 template <>
 void XmlReader::Read<int16_t>(int16_t& val, const std::string& data) {
-	std::istringstream s(data);
-	s >> val;
+	ReadToken(val, data);
 }
 
 template <>
 void XmlReader::Read<uint32_t>(uint32_t& val, const std::string& data) {
-	std::istringstream s(data);
-	s >> val;
+	ReadToken(val, data);
 }
 
 template <>
 void XmlReader::Read<double>(double& val, const std::string& data) {
-	std::istringstream s(data);
-	s >> val;
+	ReadToken(val, data);
 }
 
 template <>
@@ -178,40 +382,48 @@ template <>
 void XmlReader::Read<DBString>(DBString& val, const std::string& data) {
 	std::string sval;
 	Read(sval, data);
-	val = DBString(sval);
+	auto* pool = DBStringPool::Current();
+	val = pool ? pool->Intern(sval) : DBString(sval);
 }
 
 template <>
 void XmlReader::Read<DBBitArray>(DBBitArray& val, const std::string& data) {
-	// FIXME: Adds copies
-	std::vector<bool> tmp;
-	ReadVector(tmp, data);
-	val = DBBitArray(tmp.begin(), tmp.end());
+	DBBitArray bits(CountTokens(data));
+	const char* p = data.data();
+	const char* const end = p + data.size();
+	const char* token;
+	for (size_t i = 0; NextToken(p, end, token); ++i) {
+		bool x;
+		ParseToken(token, p, x);
+		bits[i] = x;
+	}
+	val = std::move(bits);
 }
 
 template <class T>
 void XmlReader::ReadVector(std::vector<T>& val, const std::string& data) {
 	val.clear();
-	std::istringstream s(data);
-	for (;;) {
-		std::string str;
-		s >> str;
-		if (!s.fail()) {
-			T x;
-			XmlReader::Read<T>(x, str);
-			val.push_back(x);
-		}
-		if (!s.good())
-			break;
+	val.reserve(CountTokens(data));
+	const char* p = data.data();
+	const char* const end = p + data.size();
+	const char* token;
+	while (NextToken(p, end, token)) {
+		T x;
+		ParseToken(token, p, x);
+		val.push_back(x);
 	}
 }
 
 template <class T>
 void XmlReader::ReadVector(DBArray<T>& val, const std::string& data) {
-	// FIXME: Adds copies
-	std::vector<T> tmp;
-	ReadVector(tmp, data);
-	val = DBArray<T>(tmp.begin(), tmp.end());
+	DBArray<T> arr(CountTokens(data));
+	const char* p = data.data();
+	const char* const end = p + data.size();
+	const char* token;
+	for (size_t i = 0; NextToken(p, end, token); ++i) {
+		ParseToken(token, p, arr[i]);
+	}
+	val = std::move(arr);
 }
 
 template <>
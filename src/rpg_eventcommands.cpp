@@ -0,0 +1,68 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/rpg/commonevent.h"
+#include "lcf/rpg/eventpage.h"
+#include <type_traits>
+
+namespace lcf {
+
+// Vectors of pages and common events must move the command lists on growth
+static_assert(std::is_nothrow_move_constructible<rpg::EventPage>::value, "EventPage must be nothrow movable");
+static_assert(std::is_nothrow_move_constructible<rpg::CommonEvent>::value, "CommonEvent must be nothrow movable");
+
+namespace {
+
+template <typename T>
+void InsertCommand(T& obj, size_t pos, rpg::EventCommand command) {
+	obj.event_commands.insert(obj.event_commands.begin() + pos, std::move(command));
+	obj.event_command_index.Reset();
+}
+
+template <typename T>
+void EraseCommand(T& obj, size_t pos) {
+	obj.event_commands.erase(obj.event_commands.begin() + pos);
+	obj.event_command_index.Reset();
+}
+
+} // namespace
+
+std::shared_ptr<const EventCommandIndex> rpg::CommonEvent::CommandIndex() const {
+	return event_command_index.Get(event_commands);
+}
+
+void rpg::CommonEvent::InsertCommand(size_t pos, EventCommand command) {
+	lcf::InsertCommand(*this, pos, std::move(command));
+}
+
+void rpg::CommonEvent::EraseCommand(size_t pos) {
+	lcf::EraseCommand(*this, pos);
+}
+
+void rpg::CommonEvent::InvalidateCommandIndex() {
+	event_command_index.Reset();
+}
+
+std::shared_ptr<const EventCommandIndex> rpg::EventPage::CommandIndex() const {
+	return event_command_index.Get(event_commands);
+}
+
+void rpg::EventPage::InsertCommand(size_t pos, EventCommand command) {
+	lcf::InsertCommand(*this, pos, std::move(command));
+}
+
+void rpg::EventPage::EraseCommand(size_t pos) {
+	lcf::EraseCommand(*this, pos);
+}
+
+void rpg::EventPage::InvalidateCommandIndex() {
+	event_command_index.Reset();
+}
+
+} // namespace lcf
@@ -11,18 +11,94 @@
 
 #include "lcf/writer_lcf.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define LCF_WRITER_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
+#  define LCF_WRITER_NEON
+#endif
+
 namespace lcf {
 
+namespace {
+
+#ifdef WORDS_BIGENDIAN
+// Written as plain loops so that the compiler vectorizes them
+void StoreLittleEndian16(const uint16_t* src, size_t count, uint8_t* dst) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[2 * i] = static_cast<uint8_t>(src[i]);
+		dst[2 * i + 1] = static_cast<uint8_t>(src[i] >> 8);
+	}
+}
+
+void StoreLittleEndian32(const uint32_t* src, size_t count, uint8_t* dst) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[4 * i] = static_cast<uint8_t>(src[i]);
+		dst[4 * i + 1] = static_cast<uint8_t>(src[i] >> 8);
+		dst[4 * i + 2] = static_cast<uint8_t>(src[i] >> 16);
+		dst[4 * i + 3] = static_cast<uint8_t>(src[i] >> 24);
+	}
+}
+#endif
+
+/**
+ * Expands a bit array to one byte per bit, the inverse of the packing
+ * done by LcfReader::ReadBits.
+ */
+void UnpackBits(const uint8_t* src, size_t count, uint8_t* dst) {
+	size_t i = 0;
+#if defined(LCF_WRITER_SSE2)
+	const auto weights = _mm_set1_epi64x(INT64_C(0x8040201008040201));
+	const auto one = _mm_set1_epi8(1);
+	for (; count - i >= 16; i += 16) {
+		auto v = _mm_cvtsi32_si128(src[i / 8] | (src[i / 8 + 1] << 8));
+		// Spread the two bytes over eight lanes each
+		v = _mm_unpacklo_epi8(v, v);
+		v = _mm_unpacklo_epi16(v, v);
+		v = _mm_unpacklo_epi32(v, v);
+		v = _mm_cmpeq_epi8(_mm_and_si128(v, weights), weights);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(v, one));
+	}
+#elif defined(LCF_WRITER_NEON)
+	static const uint8_t weights_data[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	const auto weights = vld1q_u8(weights_data);
+	const auto one = vdupq_n_u8(1);
+	for (; count - i >= 16; i += 16) {
+		const auto v = vcombine_u8(vdup_n_u8(src[i / 8]), vdup_n_u8(src[i / 8 + 1]));
+		vst1q_u8(dst + i, vandq_u8(vtstq_u8(v, weights), one));
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] = (src[i / 8] >> (i % 8)) & 1;
+	}
+}
+
+} // namespace
+
 LcfWriter::LcfWriter(std::ostream& filestream, EngineVersion engine, std::string encoding)
-	: stream(filestream)
+	: stream(&filestream)
 	, encoder(std::move(encoding))
 	, engine(engine)
+{
+	stream_pos = filestream.tellp();
+}
+
+LcfWriter::LcfWriter(EngineVersion engine, std::string encoding)
+	: encoder(std::move(encoding))
+	, engine(engine)
 {
 }
 
+LcfWriter::~LcfWriter() {
+	if (open_chunks.empty()) {
+		Flush();
+	}
+}
+
 void LcfWriter::Write(const void *ptr, size_t size, size_t nmemb) {
-	stream.write(reinterpret_cast<const char*>(ptr), size*nmemb);
-	assert(stream.good());
+	const auto* bytes = reinterpret_cast<const uint8_t*>(ptr);
+	buffer.insert(buffer.end(), bytes, bytes + size*nmemb);
 }
 
 template <>
@@ -47,11 +123,19 @@ void LcfWriter::Write<uint32_t>(uint32_t val) {
 	Write(&val, 4, 1);
 }
 
-void LcfWriter::WriteInt(int val) {
-	uint32_t value = (uint32_t) val;
+static int EncodeInt(uint32_t value, uint8_t* out) {
+	int n = 0;
 	for (int i = 28; i >= 0; i -= 7)
 		if (value >= (1U << i) || i == 0)
-			Write<uint8_t>((uint8_t)(((value >> i) & 0x7F) | (i > 0 ? 0x80 : 0)));
+			out[n++] = (uint8_t)(((value >> i) & 0x7F) | (i > 0 ? 0x80 : 0));
+	return n;
+}
+
+void LcfWriter::WriteInt(int val) {
+	// Encode in place, the buffer is shrunk to the used size afterwards
+	const auto size = buffer.size();
+	buffer.resize(size + 5);
+	buffer.resize(size + EncodeInt((uint32_t) val, buffer.data() + size));
 }
 
 void LcfWriter::WriteUInt64(uint64_t value) {
@@ -79,69 +163,142 @@ void LcfWriter::Write<double>(double val) {
 
 template <>
 void LcfWriter::Write<bool>(const std::vector<bool>& buffer) {
-	std::vector<bool>::const_iterator it;
-	for (it = buffer.begin(); it != buffer.end(); it++) {
-		uint8_t val = *it ? 1 : 0;
-		Write(val);
+	auto* p = Append(buffer.size());
+	for (bool val: buffer) {
+		*p++ = val ? 1 : 0;
 	}
 }
 
 template <>
 void LcfWriter::Write<uint8_t>(const std::vector<uint8_t>& buffer) {
-	Write(&buffer.front(), 1, buffer.size());
+	Write(buffer.data(), 1, buffer.size());
 }
 
 template <>
 void LcfWriter::Write<int16_t>(const std::vector<int16_t>& buffer) {
-	std::vector<int16_t>::const_iterator it;
-	for (it = buffer.begin(); it != buffer.end(); it++)
-		Write(*it);
+#ifdef WORDS_BIGENDIAN
+	StoreLittleEndian16(reinterpret_cast<const uint16_t*>(buffer.data()), buffer.size(), Append(buffer.size() * 2));
+#else
+	Write(buffer.data(), 2, buffer.size());
+#endif
 }
 
 template <>
 void LcfWriter::Write<int32_t>(const std::vector<int32_t>& buffer) {
-	std::vector<int32_t>::const_iterator it;
-	for (it = buffer.begin(); it != buffer.end(); it++) {
-		int32_t val = *it;
-		SwapByteOrder(val);
-		// Write<int32_t> writes a compressed integer
-		Write(&val, 4, 1);
-	}
+	// Unlike Write<int32_t> the elements are not compressed
+#ifdef WORDS_BIGENDIAN
+	StoreLittleEndian32(reinterpret_cast<const uint32_t*>(buffer.data()), buffer.size(), Append(buffer.size() * 4));
+#else
+	Write(buffer.data(), 4, buffer.size());
+#endif
 }
 
 template <>
 void LcfWriter::Write<uint32_t>(const std::vector<uint32_t>& buffer) {
-	std::vector<uint32_t>::const_iterator it;
-	for (it = buffer.begin(); it != buffer.end(); it++)
-		Write(*it);
+#ifdef WORDS_BIGENDIAN
+	StoreLittleEndian32(buffer.data(), buffer.size(), Append(buffer.size() * 4));
+#else
+	Write(buffer.data(), 4, buffer.size());
+#endif
 }
 
 void LcfWriter::Write(const std::string& _str) {
-	std::string str = Decode(_str);
+	auto str = DecodeBuffered(_str);
 	if (!str.empty()) {
-		Write(&*str.begin(), 1, str.size());
+		Write(str.data(), 1, str.size());
 	}
 }
 
 void LcfWriter::Write(const DBString& _str) {
-	std::string str = Decode(_str);
+	auto str = DecodeBuffered(_str);
 	if (!str.empty()) {
-		Write(&*str.begin(), 1, str.size());
+		Write(str.data(), 1, str.size());
 	}
 }
 
 void LcfWriter::Write(const DBBitArray& bits) {
-	for (auto& b: bits) {
-		Write(static_cast<uint8_t>(b));
+	UnpackBits(bits.bytes(), bits.size(), Append(bits.size()));
+}
+
+uint8_t* LcfWriter::Append(size_t size) {
+	const auto old_size = buffer.size();
+	buffer.resize(old_size + size);
+	return buffer.data() + old_size;
+}
+
+size_t LcfWriter::BeginChunk() {
+	if (open_chunks.empty()) {
+		// Strings of the previous top-level chunk are not written again
+		decode_cache.clear();
+	}
+	open_chunks.push_back(chunk_fixups.size());
+	chunk_fixups.emplace_back();
+	chunk_fixups.back().pos = buffer.size();
+	return buffer.size();
+}
+
+void LcfWriter::EndChunk(size_t chunk) {
+	assert(!open_chunks.empty() && chunk <= buffer.size());
+
+	auto& fixup = chunk_fixups[open_chunks.back()];
+	assert(fixup.pos == chunk);
+	open_chunks.pop_back();
+	fixup.length_size = EncodeInt(static_cast<uint32_t>(buffer.size() - chunk + fixup.nested), fixup.length);
+
+	if (!open_chunks.empty()) {
+		chunk_fixups[open_chunks.back()].nested += fixup.nested + fixup.length_size;
+	} else {
+		InsertChunkLengths();
+		decode_cache.clear();
+	}
+}
+
+void LcfWriter::InsertChunkLengths() {
+	size_t shift = 0;
+	for (const auto& fixup: chunk_fixups) {
+		shift += fixup.length_size;
+	}
+
+	// Back to front, every byte is moved once to its final position
+	size_t end = buffer.size();
+	buffer.resize(end + shift);
+	auto* data = buffer.data();
+	for (auto it = chunk_fixups.rbegin(); it != chunk_fixups.rend(); ++it) {
+		std::memmove(data + it->pos + shift, data + it->pos, end - it->pos);
+		shift -= it->length_size;
+		std::memcpy(data + it->pos + shift, it->length, it->length_size);
+		end = it->pos;
 	}
+	chunk_fixups.clear();
+}
+
+void LcfWriter::Flush() {
+	assert(open_chunks.empty());
+	if (stream && !buffer.empty()) {
+		stream->write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+		stream_pos += buffer.size();
+		buffer.clear();
+	}
+}
+
+std::vector<uint8_t> LcfWriter::TakeBuffer() {
+	assert(open_chunks.empty());
+	stream_pos += buffer.size();
+	auto out = std::move(buffer);
+	buffer.clear();
+	return out;
 }
 
 uint32_t LcfWriter::Tell() {
-	return (uint32_t)stream.tellp();
+	size_t pending = 0;
+	for (auto i: open_chunks) {
+		pending += chunk_fixups[i].nested + 1;
+	}
+	return stream_pos + buffer.size() + pending;
 }
 
 bool LcfWriter::IsOk() const {
-	return stream.good() && encoder.IsOk();
+	return (!stream || stream->good()) && encoder.IsOk();
 }
 
 std::string LcfWriter::Decode(std::string_view str) {
@@ -150,6 +307,29 @@ std::string LcfWriter::Decode(std::string_view str) {
 	return copy;
 }
 
+std::string_view LcfWriter::DecodeBuffered(std::string_view str) {
+	if (!encoder.NeedsConversion(str)) {
+		return str;
+	}
+	decode_buffer.assign(str.data(), str.size());
+	encoder.Decode(decode_buffer);
+	return decode_buffer;
+}
+
+std::string_view LcfWriter::DecodeCached(std::string_view str) {
+	if (!encoder.NeedsConversion(str)) {
+		return str;
+	}
+
+	auto result = decode_cache.try_emplace(DecodeKey{ str.data(), str.size() });
+	auto& entry = result.first->second;
+	if (result.second) {
+		entry.assign(str.data(), str.size());
+		encoder.Decode(entry);
+	}
+	return entry;
+}
+
 #ifdef WORDS_BIGENDIAN
 void LcfWriter::SwapByteOrder(uint16_t& us)
 {
@@ -7,6 +7,9 @@
  * file that was distributed with this source code.
  */
 
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <ostream>
 #include <vector>
 
@@ -16,31 +19,139 @@
 #include "lcf/dbarray.h"
 #include "lcf/dbbitarray.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define LCF_WRITER_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
+#  define LCF_WRITER_NEON
+#endif
+
 namespace lcf {
 
-XmlWriter::XmlWriter(std::ostream& filestream, EngineVersion engine) :
+namespace {
+
+/** The buffer is written to the stream when it grows beyond this */
+constexpr size_t flush_threshold = 65536;
+
+template <typename T>
+void AppendInt(std::string& out, T val) {
+	char temp[16];
+	const auto result = std::to_chars(temp, temp + sizeof(temp), val);
+	out.append(temp, result.ptr);
+}
+
+void AppendValue(std::string& out, bool val) {
+	out.push_back(val ? 'T' : 'F');
+}
+
+void AppendValue(std::string& out, uint8_t val) {
+	AppendInt<int>(out, val);
+}
+
+void AppendValue(std::string& out, int16_t val) {
+	AppendInt<int>(out, val);
+}
+
+void AppendValue(std::string& out, int32_t val) {
+	AppendInt(out, val);
+}
+
+void AppendValue(std::string& out, uint32_t val) {
+	AppendInt(out, val);
+}
+
+void AppendValue(std::string& out, double val) {
+	// Same as the default formatting of streams (%g)
+	char temp[32];
+#ifdef __cpp_lib_to_chars
+	const auto result = std::to_chars(temp, temp + sizeof(temp), val, std::chars_format::general, 6);
+	out.append(temp, result.ptr);
+#else
+	const int len = snprintf(temp, sizeof(temp), "%g", val);
+	out.append(temp, len);
+#endif
+}
+
+/** @return whether WriteString has to handle c specially */
+bool IsSpecial(char c) {
+	return static_cast<unsigned char>(c) < 32 || c == '<' || c == '>' || c == '&';
+}
+
+/** @return the length of the prefix of s that is copied unmodified */
+size_t PlainPrefix(const char* s, size_t n) {
+	size_t i = 0;
+#if defined(LCF_WRITER_SSE2)
+	const auto max_control = _mm_set1_epi8(31);
+	const auto lt = _mm_set1_epi8('<');
+	const auto gt = _mm_set1_epi8('>');
+	const auto amp = _mm_set1_epi8('&');
+	for (; n - i >= 16; i += 16) {
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		const auto control = _mm_cmpeq_epi8(_mm_min_epu8(v, max_control), v);
+		const auto markup = _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_cmpeq_epi8(v, amp)));
+		if (_mm_movemask_epi8(_mm_or_si128(control, markup)) != 0) {
+			break;
+		}
+	}
+#elif defined(LCF_WRITER_NEON)
+	const auto space = vdupq_n_u8(32);
+	const auto lt = vdupq_n_u8('<');
+	const auto gt = vdupq_n_u8('>');
+	const auto amp = vdupq_n_u8('&');
+	for (; n - i >= 16; i += 16) {
+		const auto v = vld1q_u8(reinterpret_cast<const uint8_t*>(s + i));
+		const auto markup = vorrq_u8(vceqq_u8(v, lt), vorrq_u8(vceqq_u8(v, gt), vceqq_u8(v, amp)));
+		if (vmaxvq_u8(vorrq_u8(vcltq_u8(v, space), markup)) != 0) {
+			break;
+		}
+	}
+#endif
+	while (i < n && !IsSpecial(s[i])) {
+		++i;
+	}
+	return i;
+}
+
+} // namespace
+
+XmlWriter::XmlWriter(std::ostream& filestream, EngineVersion engine, bool compact) :
 	stream(filestream),
 	indent(0),
 	at_bol(true),
+	compact(compact),
 	engine(engine)
 {
-	stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	buffer.reserve(flush_threshold + flush_threshold / 4);
+	buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
 }
 
 
 XmlWriter::~XmlWriter() {
+	Flush();
+}
+
+void XmlWriter::Close() {
+	Flush();
+}
+
+void XmlWriter::Flush() {
+	if (!buffer.empty()) {
+		stream.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
 }
 
 template <>
 void XmlWriter::Write<bool>(const bool& val) {
 	Indent();
-	stream << (val ? "T" : "F");
+	AppendValue(buffer, val);
 }
 
 template <>
 void XmlWriter::Write<int32_t>(const int32_t& val) {
 	Indent();
-	stream << val;
+	AppendValue(buffer, val);
 }
 
 template <>
@@ -61,45 +172,52 @@ void XmlWriter::Write<int16_t>(const int16_t& val) {
 template <>
 void XmlWriter::Write<uint32_t>(const uint32_t& val) {
 	Indent();
-	stream << val;
+	AppendValue(buffer, val);
 }
 
 template <>
 void XmlWriter::Write<double>(const double& val) {
 	Indent();
-	stream << val;
+	AppendValue(buffer, val);
 }
 
 void XmlWriter::WriteString(std::string_view val) {
+	static const char hex[] = "0123456789abcdef";
+
 	Indent();
-	for (auto c: val) {
+	for (;;) {
+		// Runs without special characters are copied at once
+		const size_t len = PlainPrefix(val.data(), val.size());
+		buffer.append(val.data(), len);
+		if (len == val.size()) {
+			break;
+		}
+
+		const char c = val[len];
 		switch (c) {
 			case '<':
-				stream << "&lt;";
+				buffer += "&lt;";
 				break;
 			case '>':
-				stream << "&gt;";
+				buffer += "&gt;";
 				break;
 			case '&':
-				stream << "&amp;";
+				buffer += "&amp;";
 				break;
 			case '\n':
-				stream.put(c);
-				break;
 			case '\r':
 			case '\t':
-				stream.put(c);
+				buffer.push_back(c);
 				break;
-			default:
-				if (c >= 0 && c < 32) {
-					char temp[10];
-					snprintf(temp,10, "&#x%04x;", 0xE000 + c);
-					stream << temp;
-				}
-				else
-					stream.put(c);
+			default: {
+				// Control codes are not allowed in XML, they are remapped
+				// to the private-use area at U+E000
+				const char temp[] = { '&', '#', 'x', 'e', '0', hex[c >> 4], hex[c & 15], ';' };
+				buffer.append(temp, sizeof(temp));
 				break;
+			}
 		}
+		val.remove_prefix(len + 1);
 	}
 }
 
@@ -188,9 +306,9 @@ void XmlWriter::WriteVector(const ArrayType& val) {
 	bool first = true;
 	for (auto&& e: val) {
 		if (!first)
-			stream.put(' ');
+			buffer.push_back(' ');
 		first = false;
-		Write<typename ArrayType::value_type>(e);
+		AppendValue(buffer, static_cast<typename ArrayType::value_type>(e));
 	}
 }
 
@@ -204,38 +322,57 @@ void XmlWriter::WriteNode(const std::string& name, const T& val) {
 void XmlWriter::BeginElement(const std::string& name) {
 	NewLine();
 	Indent();
-	stream << "<" << name << ">";
+	buffer.push_back('<');
+	buffer += name;
+	buffer.push_back('>');
 	indent++;
 }
 
 void XmlWriter::BeginElement(const std::string& name, int ID) {
 	NewLine();
 	Indent();
-	char temp[6];
-	snprintf(temp, 6, "%04d", ID);
-	stream << "<" << name << " id=\"" << temp << "\">";
+	buffer.push_back('<');
+	buffer += name;
+	buffer += " id=\"";
+	if (ID >= 0) {
+		// Zero padded to 4 digits
+		char temp[16];
+		const auto end = std::to_chars(temp, temp + sizeof(temp), ID).ptr;
+		buffer.append(std::max<ptrdiff_t>(4 - (end - temp), 0), '0');
+		buffer.append(temp, end);
+	} else {
+		char temp[16];
+		const int len = snprintf(temp, sizeof(temp), "%04d", ID);
+		buffer.append(temp, len);
+	}
+	buffer += "\">";
 	indent++;
 }
 
 void XmlWriter::EndElement(const std::string& name) {
 	indent--;
 	Indent();
-	stream << "</" << name << ">";
+	buffer += "</";
+	buffer += name;
+	buffer.push_back('>');
 	NewLine();
+	if (buffer.size() >= flush_threshold) {
+		Flush();
+	}
 }
 
 void XmlWriter::NewLine() {
 	if (at_bol)
 		return;
-	stream.put('\n');
+	buffer.push_back('\n');
 	at_bol = true;
 }
 
 void XmlWriter::Indent() {
 	if (!at_bol)
 		return;
-	for (int i = 0; i < indent; i++)
-		stream.put(' ');
+	if (!compact)
+		buffer.append(indent, ' ');
 	at_bol = false;
 }
 
@@ -0,0 +1,146 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/chunk_visitor.h"
+#include "lcf/ldb/reader.h"
+#include "lcf/lmu/reader.h"
+#include "doctest.h"
+#include "test_database.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("ChunkVisitor");
+
+namespace {
+
+/** Records the walk as text */
+class RecordingVisitor : public ChunkVisitor {
+public:
+	bool BeginStruct(const char* struct_name, int32_t id, int depth) override {
+		log += std::to_string(depth) + ":" + struct_name + "#" + std::to_string(id) + " ";
+		return skip_struct.empty() || skip_struct != struct_name;
+	}
+	bool BeginChunk(const Chunk& chunk) override {
+		++chunks;
+		return chunk.field_name == nullptr || skip_field != chunk.field_name;
+	}
+	void Integer(const Chunk& chunk, int64_t value) override {
+		if (!std::strcmp(chunk.field_name, "initial_level") || !std::strcmp(chunk.field_name, "ldb_id")) {
+			log += std::string(chunk.field_name) + "=" + std::to_string(value) + " ";
+		}
+	}
+	void String(const Chunk& chunk, std::string_view value) override {
+		log += std::string(chunk.struct_name) + "." + chunk.field_name + "=" + std::string(value) + " ";
+	}
+
+	std::string log;
+	std::string skip_struct;
+	std::string skip_field;
+	int chunks = 0;
+};
+
+} // namespace
+
+TEST_CASE("Database") {
+	const auto buf = SaveTestDatabase();
+
+	RecordingVisitor visitor;
+	REQUIRE(LDB_Reader::Visit(MakeSpan(buf), visitor));
+	const auto& log = visitor.log;
+	REQUIRE_NE(log.find("0:Database#0 "), std::string::npos);
+	REQUIRE_NE(log.find("1:Actor#1 Actor.name=Alex "), std::string::npos);
+	REQUIRE_NE(log.find("initial_level=5 "), std::string::npos);
+	REQUIRE_NE(log.find("1:Actor#2 Actor.name=Brian "), std::string::npos);
+	REQUIRE_NE(log.find("1:Skill#1 Skill.name=Heal "), std::string::npos);
+	REQUIRE_NE(log.find("1:System#0 "), std::string::npos);
+	REQUIRE_NE(log.find("ldb_id=2003 "), std::string::npos);
+	REQUIRE_NE(log.find("System.title_name=Title "), std::string::npos);
+}
+
+TEST_CASE("Skip") {
+	const auto buf = SaveTestDatabase();
+
+	RecordingVisitor all;
+	REQUIRE(LDB_Reader::Visit(MakeSpan(buf), all));
+
+	// Skipping a chunk skips the structs inside
+	RecordingVisitor skip_chunk;
+	skip_chunk.skip_field = "actors";
+	REQUIRE(LDB_Reader::Visit(MakeSpan(buf), skip_chunk));
+	REQUIRE_EQ(skip_chunk.log.find("Actor"), std::string::npos);
+	REQUIRE_NE(skip_chunk.log.find("Skill.name=Heal "), std::string::npos);
+	REQUIRE_LT(skip_chunk.chunks, all.chunks);
+
+	// Skipping a struct still walks the following elements
+	RecordingVisitor skip_struct;
+	skip_struct.skip_struct = "Actor";
+	REQUIRE(LDB_Reader::Visit(MakeSpan(buf), skip_struct));
+	REQUIRE_NE(skip_struct.log.find("1:Actor#1 1:Actor#2 "), std::string::npos);
+	REQUIRE_EQ(skip_struct.log.find("Alex"), std::string::npos);
+	REQUIRE_NE(skip_struct.log.find("Skill.name=Heal "), std::string::npos);
+}
+
+TEST_CASE("Invalid") {
+	auto buf = SaveTestDatabase();
+
+	RecordingVisitor visitor;
+	const std::vector<uint8_t> not_lcf = { 0x03, 'a', 'b', 'c' };
+	REQUIRE_FALSE(LDB_Reader::Visit(MakeSpan(not_lcf), visitor));
+	REQUIRE_FALSE(LMU_Reader::Visit(MakeSpan(buf), visitor));
+
+	// Truncated data is detected
+	buf.resize(buf.size() / 2);
+	REQUIRE_FALSE(LDB_Reader::Visit(MakeSpan(buf), visitor));
+}
+
+TEST_CASE("Map") {
+	rpg::Map map;
+	map.width = 3;
+	map.height = 2;
+	map.lower_layer = { 1, 2, 3, 4, 5, 6 };
+	map.events.resize(1);
+	map.events[0].ID = 7;
+	map.events[0].name = "Door";
+	map.events[0].pages.resize(1);
+	map.events[0].pages[0].ID = 1;
+	const auto buf = LMU_Reader::SaveToBuffer(map, EngineVersion::e2k3);
+
+	class MapVisitor : public ChunkVisitor {
+	public:
+		bool BeginStruct(const char* struct_name, int32_t id, int depth) override {
+			structs += std::to_string(depth) + ":" + struct_name + "#" + std::to_string(id) + " ";
+			return true;
+		}
+		void Integer(const Chunk& chunk, int64_t value) override {
+			if (!std::strcmp(chunk.field_name, "width")) {
+				width = value;
+			}
+		}
+		void EndChunk(const Chunk& chunk) override {
+			if (chunk.field_name != nullptr && !std::strcmp(chunk.field_name, "lower_layer")) {
+				lower_layer_size = chunk.data.size();
+			}
+		}
+
+		std::string structs;
+		int64_t width = 0;
+		size_t lower_layer_size = 0;
+	} visitor;
+
+	REQUIRE(LMU_Reader::Visit(MakeSpan(buf), visitor));
+	REQUIRE_EQ(visitor.width, 3);
+	REQUIRE_EQ(visitor.lower_layer_size, 6 * sizeof(int16_t));
+	REQUIRE_NE(visitor.structs.find("0:Map#0 1:Event#7 2:EventPage#1 "), std::string::npos);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,102 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/dbarena.h"
+#include "lcf/dbarray.h"
+#include "lcf/dbbitarray.h"
+#include "lcf/dbstring.h"
+#include "doctest.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("DBArena");
+
+static bool FromArena(const void* p) {
+	return (*DBArrayAlloc::get_size_ptr(p) & DBArrayAlloc::arena_flag) != 0;
+}
+
+TEST_CASE("Scope") {
+	REQUIRE_FALSE(DBArenaScope::IsActive());
+	{
+		DBArenaScope arena;
+		REQUIRE(DBArenaScope::IsActive());
+		{
+			DBArenaScope inner;
+			REQUIRE(DBArenaScope::IsActive());
+		}
+		REQUIRE(DBArenaScope::IsActive());
+	}
+	REQUIRE_FALSE(DBArenaScope::IsActive());
+}
+
+TEST_CASE("OutliveScope") {
+	DBString s;
+	DBArray<int32_t> a;
+	DBBitArray b;
+	{
+		DBArenaScope arena;
+		s = DBString("arena string");
+		a = DBArray<int32_t>{ 1, 2, 3 };
+		b = DBBitArray(40, true);
+		REQUIRE(FromArena(s.data()));
+		REQUIRE(FromArena(a.data()));
+	}
+	REQUIRE_EQ(s, "arena string");
+	REQUIRE_EQ(s.size(), 12);
+	REQUIRE_EQ(a.size(), 3);
+	REQUIRE_EQ(a[2], 3);
+	REQUIRE_EQ(b.size(), 40);
+	REQUIRE(b[39]);
+
+	// Copies after the scope use the heap
+	auto c = s;
+	REQUIRE_FALSE(FromArena(c.data()));
+	REQUIRE_EQ(c, s);
+	s = DBString();
+	REQUIRE_EQ(c, "arena string");
+}
+
+TEST_CASE("ManyBlocks") {
+	std::vector<DBString> strings;
+	{
+		DBArenaScope arena;
+		for (int i = 0; i < 20000; ++i) {
+			strings.emplace_back(std::string(i % 64, 'a' + i % 26));
+		}
+		// Too large for the arena
+		strings.emplace_back(std::string(100000, 'x'));
+		REQUIRE_FALSE(FromArena(strings.back().data()));
+	}
+	for (int i = 0; i < 20000; ++i) {
+		REQUIRE_EQ(strings[i].size(), i % 64);
+	}
+	// Free in random order
+	for (size_t i = 0; i < strings.size(); i += 2) {
+		strings[i] = DBString();
+	}
+	for (size_t i = 1; i < strings.size(); i += 2) {
+		REQUIRE_EQ(strings[i], std::string(i % 64, 'a' + i % 26));
+	}
+}
+
+TEST_CASE("Create") {
+	DBArenaScope arena;
+	auto a = DBString::Create(64, [](char* dst) { std::memcpy(dst, "abcdefghij", 10); return 10; });
+	auto b = DBString("klmnopqrst");
+	REQUIRE(FromArena(a.data()));
+	// The unused tail of a is reused
+	REQUIRE_LT(b.data() - a.data(), 64);
+	REQUIRE_EQ(a, "abcdefghij");
+	REQUIRE_EQ(b, "klmnopqrst");
+}
+
+TEST_SUITE_END();
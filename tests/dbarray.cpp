@@ -13,6 +13,7 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <stdexcept>
 
 namespace lcf {
 template class DBArray<int>;
@@ -110,6 +111,12 @@ TEST_CASE("Construct Count T") {
 	REQUIRE_EQ(x.back(), 15);
 }
 
+TEST_CASE("Construct Count Too Large") {
+	// The bits above max_size are flags of the size header
+	REQUIRE_THROWS_AS(DBArray<int>(DBArrayAlloc::max_size + 1), std::length_error);
+	REQUIRE_THROWS_AS(DBArray<char>(DBArrayAlloc::max_size + 1), std::length_error);
+}
+
 TEST_CASE("Swap") {
 	const DBArray<int> ca = {1};
 	const DBArray<int> cb = {2};
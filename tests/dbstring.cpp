@@ -10,6 +10,8 @@
 #include "lcf/dbstring.h"
 #include "doctest.h"
 
+#include <stdexcept>
+
 using namespace lcf;
 
 TEST_SUITE_BEGIN("DBString");
@@ -146,4 +148,68 @@ TEST_CASE("Move") {
 	REQUIRE_EQ(c, "");
 }
 
+TEST_CASE("Create") {
+	auto s = DBString::Create(16, [](char* dst) {
+		std::memcpy(dst, "abc", 3);
+		return 3;
+	});
+	REQUIRE_EQ(s, "abc");
+	REQUIRE_EQ(s.size(), 3);
+	REQUIRE_EQ(s.c_str()[3], '\0');
+
+	auto e = DBString::Create(16, [](char*) { return 0; });
+	REQUIRE(e.empty());
+	REQUIRE_EQ(static_cast<const void*>(e.data()), static_cast<const void*>(DBString().data()));
+
+	auto z = DBString::Create(0, [](char*) { return 0; });
+	REQUIRE(z.empty());
+
+	REQUIRE_THROWS_AS(DBString::Create(size_t(DBArrayAlloc::max_size) + 1, [](char*) { return 0; }), std::length_error);
+}
+
+TEST_CASE("Inline") {
+	static_assert(sizeof(DBString) == sizeof(void*), "DBString must stay pointer sized");
+
+	const auto is_inline = [](const DBString& s) {
+		auto* p = reinterpret_cast<const char*>(&s);
+		return s.data() >= p && s.data() < p + sizeof(s);
+	};
+
+	for (size_t len = 1; len <= DBString::inline_capacity + 1; ++len) {
+		const auto str = std::string(len, 'x');
+		auto s = DBString::Create(len, [&](char* dst) {
+			std::memcpy(dst, str.data(), len);
+			return len;
+		});
+		REQUIRE_EQ(s, str);
+		REQUIRE_EQ(s.size(), len);
+		REQUIRE_EQ(s.c_str()[len], '\0');
+		REQUIRE_EQ(is_inline(s), len <= DBString::inline_capacity);
+
+		DBString c = s;
+		REQUIRE_EQ(c, str);
+		REQUIRE_EQ(is_inline(c), is_inline(s));
+		DBString m = std::move(c);
+		REQUIRE_EQ(m, str);
+		REQUIRE(c.empty());
+
+		// Constructed strings are allocated, data() survives a move
+		DBString a(str);
+		REQUIRE_EQ(a, str);
+		REQUIRE_EQ(a.c_str()[len], '\0');
+		REQUIRE_FALSE(is_inline(a));
+		const void* p = a.data();
+		DBString b = std::move(a);
+		REQUIRE_EQ(static_cast<const void*>(b.data()), p);
+	}
+
+	// Shrinking into inline storage
+	auto s = DBString::Create(64, [](char* dst) { dst[0] = 'a'; return 1; });
+	REQUIRE_EQ(s, "a");
+	REQUIRE(is_inline(s));
+
+	s[0] = 'b';
+	REQUIRE_EQ(s, "b");
+}
+
 TEST_SUITE_END();
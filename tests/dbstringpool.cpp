@@ -0,0 +1,131 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/dbstringpool.h"
+#include "lcf/reader_lcf.h"
+#include "doctest.h"
+
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("DBStringPool");
+
+// doctest compares char pointers as strings
+static const void* Addr(const char* p) {
+	return p;
+}
+
+TEST_CASE("Intern") {
+	DBStringPool pool;
+	auto a = pool.Intern("Monster1");
+	auto b = pool.Intern("Monster1");
+	auto c = pool.Intern("Monster2");
+
+	REQUIRE_EQ(a, "Monster1");
+	REQUIRE_EQ(Addr(a.c_str()), Addr(b.c_str()));
+	REQUIRE_NE(Addr(a.c_str()), Addr(c.c_str()));
+	REQUIRE(pool.Intern("").empty());
+	// Short strings are stored inline
+	REQUIRE_EQ(pool.Intern("A"), "A");
+
+	const auto stats = pool.GetStats();
+	REQUIRE_EQ(stats.unique_strings, 2);
+	REQUIRE_EQ(stats.unique_bytes, 16);
+	REQUIRE_EQ(stats.lookups, 3);
+	REQUIRE_EQ(stats.bytes_saved, 8);
+}
+
+TEST_CASE("CopyOnWrite") {
+	DBStringPool pool;
+	const auto a = pool.Intern("Monster1");
+
+	DBString b = a;
+	REQUIRE_EQ(Addr(b.c_str()), Addr(a.c_str()));
+
+	b[7] = '2';
+	REQUIRE_EQ(b, "Monster2");
+	REQUIRE_EQ(a, "Monster1");
+	REQUIRE_EQ(Addr(pool.Intern("Monster1").c_str()), Addr(a.c_str()));
+
+	DBString c;
+	c = a;
+	REQUIRE_EQ(Addr(c.c_str()), Addr(a.c_str()));
+}
+
+TEST_CASE("CopyOnWriteAccessors") {
+	DBStringPool pool;
+	const auto a = pool.Intern("Monster1");
+	DBString b = a;
+
+	// Const access keeps the storage shared
+	const auto& cb = b;
+	REQUIRE_EQ(Addr(cb.data()), Addr(a.data()));
+	REQUIRE_EQ(Addr(cb.begin()), Addr(a.begin()));
+	REQUIRE_EQ(cb.front(), 'M');
+	size_t count = 0;
+	for (char ch: cb) {
+		count += ch != 0;
+	}
+	REQUIRE_EQ(count, 8);
+	REQUIRE_EQ(Addr(b.c_str()), Addr(a.c_str()));
+
+	// The first non-const access copies, later ones return the copy
+	auto* p = b.begin();
+	REQUIRE_NE(Addr(p), Addr(a.data()));
+	REQUIRE_EQ(Addr(b.data()), Addr(p));
+	REQUIRE_EQ(Addr(&b[0]), Addr(p));
+	REQUIRE_EQ(Addr(b.end()), Addr(p + 8));
+	REQUIRE_EQ(b, a);
+
+	// Strings not created by a pool are never copied
+	DBString c("Monster1");
+	const char* q = c.c_str();
+	REQUIRE_EQ(Addr(c.data()), Addr(q));
+	REQUIRE_EQ(Addr(c.begin()), Addr(q));
+}
+
+TEST_CASE("Lifetime") {
+	DBString a;
+	{
+		DBStringPool pool;
+		a = pool.Intern("Monster1");
+		pool.Clear();
+		REQUIRE_EQ(pool.GetStats().unique_strings, 0);
+	}
+	REQUIRE_EQ(a, "Monster1");
+	DBString b = a;
+	a = DBString();
+	REQUIRE_EQ(b, "Monster1");
+}
+
+TEST_CASE("Reader") {
+	const std::vector<uint8_t> data = {
+		0x08, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+		0x08, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+	};
+
+	DBStringPool pool;
+	DBString a, b;
+	{
+		DBStringPool::Scope scope(pool);
+		REQUIRE_EQ(DBStringPool::Current(), &pool);
+
+		LcfReader reader(MakeSpan(data));
+		reader.ReadString(a, reader.ReadInt());
+		reader.ReadString(b, reader.ReadInt());
+	}
+	REQUIRE_EQ(DBStringPool::Current(), nullptr);
+
+	REQUIRE_EQ(a, "abcdefgh");
+	REQUIRE_EQ(Addr(a.c_str()), Addr(b.c_str()));
+	REQUIRE_EQ(pool.GetStats().bytes_saved, 8);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,123 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/encoder.h"
+#include "doctest.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("Encoder");
+
+TEST_CASE("Ascii") {
+	Encoder enc("1252");
+	REQUIRE(enc.IsOk());
+
+	std::string str = "character_name.png with a longer text to cross 32 bytes";
+	const auto orig = str;
+	enc.Encode(str);
+	REQUIRE_EQ(str, orig);
+	enc.Decode(str);
+	REQUIRE_EQ(str, orig);
+}
+
+TEST_CASE("SingleByte") {
+	Encoder enc("1252");
+	REQUIRE(enc.IsOk());
+
+	std::string str = "Caf\xE9 \xC4rger";
+	enc.Encode(str);
+	REQUIRE_EQ(str, "Caf\xC3\xA9 \xC3\x84rger");
+	enc.Decode(str);
+	REQUIRE_EQ(str, "Caf\xE9 \xC4rger");
+}
+
+TEST_CASE("EncodeToBuffer") {
+	Encoder enc("1252");
+	REQUIRE(enc.IsOk());
+
+	for (std::string str: { "", "plain ascii", "Caf\xE9 \xC4rger" }) {
+		std::vector<char> buf(enc.EncodeSizeBound(str));
+		const auto len = enc.Encode(std::string_view(str), buf.data());
+		REQUIRE_LE(len, buf.size());
+
+		auto expected = str;
+		enc.Encode(expected);
+		REQUIRE_EQ(std::string(buf.data(), len), expected);
+	}
+}
+
+#if LCF_SUPPORT_ICU
+TEST_CASE("SingleByteTable") {
+	Encoder enc("1250");
+	REQUIRE(enc.IsOk());
+
+	std::string str = "\x8A\x80 ok";
+	enc.Encode(str);
+	REQUIRE_EQ(str, "\xC5\xA0\xE2\x82\xAC ok");
+	enc.Decode(str);
+	REQUIRE_EQ(str, "\x8A\x80 ok");
+
+	// Characters missing in the encoding are substituted
+	str = "\xE3\x81\x82";
+	enc.Decode(str);
+	REQUIRE_EQ(str.size(), 1);
+}
+
+TEST_CASE("MultiByte") {
+	Encoder enc("932");
+	REQUIRE(enc.IsOk());
+
+	std::string str = "\x82\xA0 abc";
+	enc.Encode(str);
+	REQUIRE_EQ(str, "\xE3\x81\x82 abc");
+	enc.Decode(str);
+	REQUIRE_EQ(str, "\x82\xA0 abc");
+}
+
+TEST_CASE("SharedTables") {
+	// The conversion tables are built once and shared by all Encoders
+	std::vector<std::thread> threads;
+	std::vector<std::string> results(8);
+	for (size_t i = 0; i < results.size(); ++i) {
+		threads.emplace_back([&results, i]() {
+			Encoder enc(i % 2 ? "1250" : "932");
+			std::string str = i % 2 ? "\x8A ok" : "\x82\xA0 ok";
+			enc.Encode(str);
+			results[i] = str;
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+	for (size_t i = 0; i < results.size(); ++i) {
+		REQUIRE_EQ(results[i], i % 2 ? "\xC5\xA0 ok" : "\xE3\x81\x82 ok");
+	}
+
+	Encoder enc("1250");
+	std::string str = "\x8A";
+	enc.Encode(str);
+	REQUIRE_EQ(str, "\xC5\xA0");
+}
+
+TEST_CASE("MultiByteToBuffer") {
+	Encoder enc("932");
+	REQUIRE(enc.IsOk());
+
+	std::string_view str = "\x82\xA0 abc";
+	std::vector<char> buf(enc.EncodeSizeBound(str));
+	const auto len = enc.Encode(str, buf.data());
+	REQUIRE_EQ(std::string(buf.data(), len), "\xE3\x81\x82 abc");
+}
+#endif
+
+TEST_SUITE_END();
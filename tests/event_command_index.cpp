@@ -0,0 +1,172 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/event_command_index.h"
+#include "lcf/event_command_list.h"
+#include "lcf/rpg/commonevent.h"
+#include "lcf/rpg/eventpage.h"
+#include "doctest.h"
+
+#include <thread>
+#include <vector>
+
+using namespace lcf;
+using Code = rpg::EventCommand::Code;
+
+TEST_SUITE_BEGIN("EventCommandIndex");
+
+static rpg::EventCommand Cmd(Code code, int32_t indent, std::vector<int32_t> params = {}) {
+	rpg::EventCommand cmd;
+	cmd.code = static_cast<int32_t>(code);
+	cmd.indent = indent;
+	cmd.parameters = DBArray<int32_t>(params.begin(), params.end());
+	return cmd;
+}
+
+static std::vector<rpg::EventCommand> MakeCommands() {
+	return {
+		Cmd(Code::ConditionalBranch, 0), // 0
+		Cmd(Code::ShowMessage, 1),
+		Cmd(Code::END, 1),
+		Cmd(Code::ElseBranch, 0), // 3
+		Cmd(Code::Loop, 1),
+		Cmd(Code::Label, 2, { 5 }), // 5
+		Cmd(Code::BreakLoop, 2),
+		Cmd(Code::END, 2),
+		Cmd(Code::EndLoop, 1), // 8
+		Cmd(Code::END, 1),
+		Cmd(Code::EndBranch, 0), // 10
+		Cmd(Code::Label, 0, { 5 }),
+		Cmd(Code::Label, 0, { 2 }),
+		Cmd(Code::END, 0), // 13
+	};
+}
+
+static void CheckIndex(const EventCommandIndex& index) {
+	constexpr auto npos = EventCommandIndex::npos;
+
+	REQUIRE_EQ(index.size(), 14);
+	REQUIRE_EQ(index.Next(0), 3);
+	REQUIRE_EQ(index.Next(3), 10);
+	REQUIRE_EQ(index.Next(1), 2);
+	REQUIRE_EQ(index.Next(2), npos);
+	REQUIRE_EQ(index.Next(4), 8);
+	REQUIRE_EQ(index.Next(13), npos);
+
+	REQUIRE_EQ(index.Previous(8), 4);
+	REQUIRE_EQ(index.Previous(10), 3);
+	REQUIRE_EQ(index.Previous(4), npos);
+
+	REQUIRE_EQ(index.Parent(0), npos);
+	REQUIRE_EQ(index.Parent(1), 0);
+	REQUIRE_EQ(index.Parent(4), 3);
+	REQUIRE_EQ(index.Parent(6), 4);
+	REQUIRE_EQ(index.Parent(11), npos);
+
+	REQUIRE_EQ(index.FindLabel(5), 5);
+	REQUIRE_EQ(index.FindLabel(2), 12);
+	REQUIRE_EQ(index.FindLabel(9), npos);
+}
+
+TEST_CASE("Vector") {
+	CheckIndex(EventCommandIndex(MakeCommands()));
+}
+
+TEST_CASE("List") {
+	EventCommandList list(MakeCommands());
+	CheckIndex(*list.Index());
+}
+
+TEST_CASE("Mutation") {
+	EventCommandList list(MakeCommands());
+	REQUIRE_EQ(list.Index()->Next(0), 3);
+
+	list.erase(1);
+	REQUIRE_EQ(list.size(), 13);
+	REQUIRE_EQ(list.Index()->Next(0), 2);
+	REQUIRE_EQ(list.Index()->FindLabel(2), 11);
+
+	const int32_t params[] = { 1, 2 };
+	list.insert(1, static_cast<int32_t>(Code::ShowMessage), 1, "Hi", params);
+	REQUIRE_EQ(list.string(1), "Hi");
+	REQUIRE_EQ(list.parameters(1).size(), 2);
+	REQUIRE_EQ(list.parameters(5)[0], 5);
+	CheckIndex(*list.Index());
+
+	const int32_t label[] = { 7 };
+	list.set_parameters(5, label);
+	REQUIRE_EQ(list.Index()->FindLabel(7), 5);
+	REQUIRE_EQ(list.Index()->FindLabel(5), 11);
+
+	list.set_parameters(1, {});
+	REQUIRE(list.parameters(1).empty());
+	REQUIRE_EQ(list.parameters(5)[0], 7);
+
+	list.push_back(static_cast<int32_t>(Code::Label), 0, "", params);
+	REQUIRE_EQ(list.Index()->FindLabel(1), 14);
+}
+
+TEST_CASE("Page") {
+	rpg::EventPage page;
+	page.event_commands = MakeCommands();
+	auto index = page.CommandIndex();
+	CheckIndex(*index);
+	REQUIRE_EQ(page.CommandIndex(), index);
+
+	// Copies share the index
+	const auto copy = page;
+	REQUIRE_EQ(copy.CommandIndex(), index);
+
+	page.EraseCommand(1);
+	REQUIRE_EQ(page.CommandIndex()->Next(0), 2);
+	REQUIRE_EQ(page.CommandIndex()->FindLabel(2), 11);
+	// Indexes returned before stay valid
+	REQUIRE_EQ(index->Next(0), 3);
+
+	page.InsertCommand(1, Cmd(Code::ShowMessage, 1));
+	CheckIndex(*page.CommandIndex());
+
+	// Direct edits of the vector need InvalidateCommandIndex
+	page.event_commands[5].parameters[0] = 9;
+	page.InvalidateCommandIndex();
+	REQUIRE_EQ(page.CommandIndex()->FindLabel(9), 5);
+
+	// Adding or removing commands is detected even without it
+	page.event_commands.pop_back();
+	REQUIRE_EQ(page.CommandIndex()->size(), 13);
+}
+
+TEST_CASE("CommonEvent") {
+	rpg::CommonEvent event;
+	event.event_commands = MakeCommands();
+	CheckIndex(*event.CommandIndex());
+
+	event.EraseCommand(13);
+	REQUIRE_EQ(event.CommandIndex()->size(), 13);
+	event.InsertCommand(13, Cmd(Code::END, 0));
+	CheckIndex(*event.CommandIndex());
+}
+
+TEST_CASE("Concurrent") {
+	const EventCommandList list(MakeCommands());
+	std::vector<std::shared_ptr<const EventCommandIndex>> indexes(8);
+	std::vector<std::thread> threads;
+	for (auto& index: indexes) {
+		threads.emplace_back([&list, &index]() { index = list.Index(); });
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+	for (auto& index: indexes) {
+		REQUIRE_EQ(index, indexes[0]);
+	}
+	CheckIndex(*indexes[0]);
+}
+
+TEST_SUITE_END();
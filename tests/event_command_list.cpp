@@ -0,0 +1,115 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/event_command_list.h"
+#include "lcf/ldb/reader.h"
+#include "lcf/lmu/reader.h"
+#include "lcf/reader_lcf.h"
+#include "lcf/writer_lcf.h"
+#include "doctest.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("EventCommandList");
+
+static std::vector<rpg::EventCommand> MakeCommands() {
+	std::vector<rpg::EventCommand> commands(3);
+	commands[0].code = static_cast<int32_t>(rpg::EventCommand::Code::ShowMessage);
+	commands[0].string = DBString("Hello");
+	commands[1].code = static_cast<int32_t>(rpg::EventCommand::Code::ControlSwitches);
+	commands[1].indent = 1;
+	commands[1].parameters = DBArray<int32_t>({ 0, 1, 1, 300 });
+	commands[2].code = static_cast<int32_t>(rpg::EventCommand::Code::END);
+	return commands;
+}
+
+TEST_CASE("FromVector") {
+	const auto commands = MakeCommands();
+	EventCommandList list(commands);
+
+	REQUIRE_EQ(list.size(), 3);
+	REQUIRE_EQ(list[0].string, "Hello");
+	REQUIRE(list[0].parameters.empty());
+	REQUIRE_EQ(list.indent(1), 1);
+	REQUIRE_EQ(list.parameters(1).size(), 4);
+	REQUIRE_EQ(list.parameters(1)[3], 300);
+	REQUIRE(list.string(2).empty());
+	REQUIRE_EQ(list.ToVector(), commands);
+
+	list.clear();
+	REQUIRE(list.empty());
+	REQUIRE(list.ToVector().empty());
+}
+
+TEST_CASE("ReadWrite") {
+	const auto commands = MakeCommands();
+
+	LcfWriter writer(EngineVersion::e2k);
+	EventCommandList(commands).WriteLcf(writer);
+	const auto buf = writer.TakeBuffer();
+	std::istringstream ss(std::string(buf.begin(), buf.end()));
+
+	LcfReader s_reader(ss);
+	LcfReader m_reader(MakeSpan(buf));
+
+	for (auto* reader: { &s_reader, &m_reader }) {
+		EventCommandList list;
+		list.ReadLcf(*reader, buf.size());
+		REQUIRE_EQ(reader->Tell(), buf.size());
+		REQUIRE_EQ(list.ToVector(), commands);
+	}
+}
+
+TEST_CASE("LoadDatabase") {
+	rpg::Database db;
+	db.commonevents.resize(2);
+	db.commonevents[0].ID = 1;
+	db.commonevents[0].event_commands = MakeCommands();
+	db.commonevents[1].ID = 2;
+	db.commonevents[1].name = "Empty";
+	db.terms.menu_save = "Save";
+	const auto buf = LDB_Reader::SaveToBuffer(db);
+
+	const auto lists = LDB_Reader::LoadEventCommands(MakeSpan(buf));
+	REQUIRE_EQ(lists.size(), 2);
+	REQUIRE_EQ(lists[0].ToVector(), db.commonevents[0].event_commands);
+	REQUIRE(lists[1].empty());
+}
+
+TEST_CASE("LoadMap") {
+	rpg::Map map;
+	map.events.resize(2);
+	map.events[0].ID = 1;
+	map.events[0].pages.resize(2);
+	map.events[0].pages[0].ID = 1;
+	map.events[0].pages[0].event_commands = MakeCommands();
+	map.events[0].pages[1].ID = 2;
+	map.events[1].ID = 2;
+	map.events[1].pages.resize(1);
+	map.events[1].pages[0].ID = 1;
+	map.events[1].pages[0].event_commands = MakeCommands();
+	map.events[1].pages[0].event_commands[0].string = DBString("Bye");
+	const auto buf = LMU_Reader::SaveToBuffer(map, EngineVersion::e2k);
+
+	const auto lists = LMU_Reader::LoadEventCommands(MakeSpan(buf));
+	REQUIRE_EQ(lists.size(), 2);
+	REQUIRE_EQ(lists[0].size(), 2);
+	REQUIRE_EQ(lists[0][0].ToVector(), map.events[0].pages[0].event_commands);
+	REQUIRE(lists[0][1].empty());
+	REQUIRE_EQ(lists[1].size(), 1);
+	REQUIRE_EQ(lists[1][0].ToVector(), map.events[1].pages[0].event_commands);
+
+	REQUIRE(LMU_Reader::LoadEventCommands(Span<const uint8_t>()).empty());
+}
+
+TEST_SUITE_END();
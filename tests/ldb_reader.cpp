@@ -0,0 +1,396 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/config.h"
+#include "lcf/ldb/reader.h"
+#include "lcf/dbarena.h"
+#include "lcf/log_handler.h"
+#include "doctest.h"
+#include "test_database.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("LDB_Reader");
+
+TEST_CASE("Lazy") {
+	const auto buf = SaveTestDatabase();
+	auto lazy = LDB_Reader::LoadLazy(MakeSpan(buf));
+	REQUIRE(lazy != nullptr);
+
+	REQUIRE(lazy->Has(LDB_Reader::ChunkDatabase::system));
+	REQUIRE_FALSE(lazy->IsLoaded(LDB_Reader::ChunkDatabase::system));
+
+	auto& db = lazy->Get(LDB_Reader::ChunkDatabase::system);
+	REQUIRE(lazy->IsLoaded(LDB_Reader::ChunkDatabase::system));
+	REQUIRE_EQ(db.system.title_name, "Title");
+	REQUIRE(db.actors.empty());
+	REQUIRE(db.skills.empty());
+
+	lazy->Get(LDB_Reader::ChunkDatabase::skills);
+	REQUIRE_EQ(db.skills.size(), 1);
+	REQUIRE_EQ(db.skills[0].name, "Heal");
+	REQUIRE(db.actors.empty());
+
+	auto full = LDB_Reader::Load(MakeSpan(buf));
+	REQUIRE(full != nullptr);
+	REQUIRE(lazy->GetAll() == *full);
+	REQUIRE_EQ(db.actors[1].name, "Brian");
+}
+
+TEST_CASE("LazyActorSetup") {
+	const auto buf = SaveTestDatabase();
+	auto full = LDB_Reader::Load(MakeSpan(buf));
+	auto lazy = LDB_Reader::LoadLazy(MakeSpan(buf));
+	REQUIRE(lazy != nullptr);
+
+	// Actors depend on the engine version stored in system
+	auto& db = lazy->Get(LDB_Reader::ChunkDatabase::actors);
+	REQUIRE(lazy->IsLoaded(LDB_Reader::ChunkDatabase::system));
+	REQUIRE(db.actors == full->actors);
+}
+
+TEST_CASE("LazyDuplicate") {
+	auto buf = SaveTestDatabase();
+
+	// Append the sections of a second database, every chunk ID is repeated
+	rpg::Database other;
+	other.actors.resize(1);
+	other.actors[0].ID = 1;
+	other.actors[0].name = "Carl";
+	other.terms.menu_save = "Store";
+	const auto other_buf = LDB_Reader::SaveToBuffer(other);
+	const size_t header_size = 1 + other_buf[0];
+	buf.insert(buf.end(), other_buf.begin() + header_size, other_buf.end());
+
+	auto full = LDB_Reader::Load(MakeSpan(buf));
+	REQUIRE(full != nullptr);
+	REQUIRE_EQ(full->terms.menu_save, "Store");
+
+	auto lazy = LDB_Reader::LoadLazy(MakeSpan(buf));
+	REQUIRE(lazy != nullptr);
+	REQUIRE(lazy->Get(LDB_Reader::ChunkDatabase::terms).terms == full->terms);
+	REQUIRE(lazy->Get(LDB_Reader::ChunkDatabase::actors).actors == full->actors);
+	REQUIRE(lazy->GetAll() == *full);
+}
+
+TEST_CASE("LazyInvalid") {
+	const std::vector<uint8_t> buf = { 3, 'a', 'b', 'c' };
+	REQUIRE(LDB_Reader::LoadLazy(MakeSpan(buf)) == nullptr);
+}
+
+static std::string SaveToString(const rpg::Database& db) {
+	std::stringstream ss;
+	LDB_Reader::Save(ss, db);
+	return ss.str();
+}
+
+TEST_CASE("Parallel") {
+	const auto buf = SaveTestDatabase();
+	auto full = LDB_Reader::Load(MakeSpan(buf));
+	REQUIRE(full != nullptr);
+
+	for (unsigned threads: { 1u, 2u, 8u }) {
+		auto db = LDB_Reader::LoadParallel(MakeSpan(buf), "", threads);
+		REQUIRE(db != nullptr);
+		REQUIRE(*db == *full);
+		REQUIRE_EQ(SaveToString(*db), SaveToString(*full));
+	}
+
+	SUBCASE("arena") {
+		std::unique_ptr<rpg::Database> db;
+		{
+			DBArenaScope arena;
+			db = LDB_Reader::LoadParallel(MakeSpan(buf), "", 4);
+		}
+		REQUIRE(db != nullptr);
+		REQUIRE(*db == *full);
+	}
+
+	SUBCASE("log") {
+		auto corrupt = LDB_Reader::Load(MakeSpan(buf));
+		corrupt->commonevents.resize(1);
+		corrupt->commonevents[0].ID = 1;
+		corrupt->commonevents[0].event_commands.resize(1);
+		corrupt->commonevents[0].event_commands[0].parameters = DBArray<int32_t>({ 0x0FFFFFFF });
+		auto corrupt_buf = LDB_Reader::SaveToBuffer(*corrupt);
+		const std::vector<uint8_t> params = { 0x01, 0xFF, 0xFF, 0xFF, 0x7F };
+		auto it = std::search(corrupt_buf.begin(), corrupt_buf.end(), params.begin(), params.end());
+		REQUIRE(it != corrupt_buf.end());
+		*it = 0x87;
+
+		// Messages of the workers are passed on by the calling thread
+		static std::vector<std::thread::id> log_threads;
+		log_threads.clear();
+		LogHandler::SetHandler([](LogHandler::Level, std::string_view, LogHandler::UserData) {
+			log_threads.push_back(std::this_thread::get_id());
+		});
+		auto db = LDB_Reader::LoadParallel(MakeSpan(corrupt_buf), "", 8);
+		LogHandler::SetHandler(nullptr);
+		REQUIRE(db != nullptr);
+		REQUIRE_FALSE(log_threads.empty());
+		for (auto& id: log_threads) {
+			REQUIRE_EQ(id, std::this_thread::get_id());
+		}
+	}
+}
+
+TEST_CASE("SaveToBuffer") {
+	const auto buf = SaveTestDatabase();
+	auto db = LDB_Reader::Load(MakeSpan(buf));
+	REQUIRE(db != nullptr);
+
+	const auto str = SaveToString(*db);
+	REQUIRE_EQ(LDB_Reader::SaveToBuffer(*db), std::vector<uint8_t>(str.begin(), str.end()));
+}
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+/** @return the .lcfcache files in dir */
+static std::vector<std::filesystem::path> FindCaches(const std::filesystem::path& dir) {
+	std::vector<std::filesystem::path> caches;
+	for (const auto& entry: std::filesystem::directory_iterator(dir)) {
+		if (entry.path().extension() == ".lcfcache") {
+			caches.push_back(entry.path());
+		}
+	}
+	std::sort(caches.begin(), caches.end());
+	return caches;
+}
+
+/** Renames the actor Alex to Axel in a cache, a load returning Axel used the cache */
+static void ChangeCache(const std::filesystem::path& cache) {
+	auto data = ReadFile(cache);
+	const std::string alex = "Alex";
+	auto it = std::search(data.begin(), data.end(), alex.begin(), alex.end());
+	REQUIRE(it != data.end());
+	std::copy_n("Axel", 4, it);
+	WriteFile(cache, data);
+}
+
+TEST_CASE("Cache") {
+	const auto dir = std::filesystem::temp_directory_path() / "liblcf_test_cache";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	const auto source = (dir / "RPG_RT.ldb").string();
+
+	WriteFile(source, SaveTestDatabase());
+	auto db = LDB_Reader::Load(source, "", dir.string());
+	REQUIRE(db != nullptr);
+	REQUIRE_EQ(db->actors[0].name, "Alex");
+	const auto caches = FindCaches(dir);
+	REQUIRE_EQ(caches.size(), 1);
+	REQUIRE_EQ(caches[0].filename().string().rfind("RPG_RT.ldb.", 0), 0);
+
+	// Changing the cache shows that it is used
+	ChangeCache(caches[0]);
+
+	db = LDB_Reader::Load(source, "", dir.string());
+	REQUIRE(db != nullptr);
+	REQUIRE_EQ(db->actors[0].name, "Axel");
+	REQUIRE_EQ(db->skills[0].name, "Heal");
+
+	// A cache of another encoding or another file is not used
+	db = LDB_Reader::Load(source, "1252", dir.string());
+	REQUIRE_EQ(db->actors[0].name, "Alex");
+	REQUIRE_EQ(FindCaches(dir).size(), 2);
+
+	auto changed = LDB_Reader::Load(MakeSpan(SaveTestDatabase()));
+	changed->actors[0].name = "Carl";
+	WriteFile(source, LDB_Reader::SaveToBuffer(*changed));
+	db = LDB_Reader::Load(source, "1252", dir.string());
+	REQUIRE_EQ(db->actors[0].name, "Carl");
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("CacheSharedDir") {
+	const auto dir = std::filesystem::temp_directory_path() / "liblcf_test_cache_shared";
+	std::filesystem::remove_all(dir);
+	const auto cache_dir = dir / "cache";
+	std::filesystem::create_directories(cache_dir);
+
+	// Two games with the same file name
+	std::vector<std::string> sources;
+	for (const char* skill: { "Heal", "Fire" }) {
+		auto db = LDB_Reader::Load(MakeSpan(SaveTestDatabase()));
+		db->skills[0].name = DBString(std::string_view(skill));
+		const auto game = dir / skill;
+		std::filesystem::create_directories(game);
+		sources.push_back((game / "RPG_RT.ldb").string());
+		WriteFile(sources.back(), LDB_Reader::SaveToBuffer(*db));
+	}
+
+	for (const auto& source: sources) {
+		REQUIRE(LDB_Reader::Load(source, "", cache_dir.string()) != nullptr);
+	}
+	const auto caches = FindCaches(cache_dir);
+	REQUIRE_EQ(caches.size(), 2);
+	for (const auto& cache: caches) {
+		ChangeCache(cache);
+	}
+
+	// Both caches are used on the second load
+	auto db = LDB_Reader::Load(sources[0], "", cache_dir.string());
+	REQUIRE(db != nullptr);
+	REQUIRE_EQ(db->actors[0].name, "Axel");
+	REQUIRE_EQ(db->skills[0].name, "Heal");
+	db = LDB_Reader::Load(sources[1], "", cache_dir.string());
+	REQUIRE(db != nullptr);
+	REQUIRE_EQ(db->actors[0].name, "Axel");
+	REQUIRE_EQ(db->skills[0].name, "Fire");
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Cache2kWith2k3Fields") {
+	const auto dir = std::filesystem::temp_directory_path() / "liblcf_test_cache_2k";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	const auto source = (dir / "RPG_RT.ldb").string();
+
+	auto src = LDB_Reader::Load(MakeSpan(SaveTestDatabase()));
+	src->actors[0].battle_x = 100;
+	src->system.system2_name = "System2";
+	auto buf = LDB_Reader::SaveToBuffer(*src);
+
+	// Turn ldb_id 2003 into 2004, the database is detected as 2k but has 2k3 fields
+	const std::vector<uint8_t> ldb_id = { 0x0A, 0x02, 0x8F, 0x53 };
+	auto it = std::search(buf.begin(), buf.end(), ldb_id.begin(), ldb_id.end());
+	REQUIRE(it != buf.end());
+	it[3] = 0x54;
+	WriteFile(source, buf);
+
+	auto direct = LDB_Reader::Load(MakeSpan(buf));
+	REQUIRE(direct != nullptr);
+	REQUIRE_EQ(GetEngineVersion(*direct), EngineVersion::e2k);
+	REQUIRE_EQ(direct->actors[0].battle_x, 100);
+
+	auto db = LDB_Reader::Load(source, "", dir.string());
+	REQUIRE(db != nullptr);
+	REQUIRE_EQ(FindCaches(dir).size(), 1);
+	db = LDB_Reader::Load(source, "", dir.string());
+	REQUIRE(db != nullptr);
+	REQUIRE(*db == *direct);
+	REQUIRE_EQ(db->system.system2_name, "System2");
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("CorruptParameterCount") {
+	rpg::Database db;
+	db.commonevents.resize(1);
+	db.commonevents[0].ID = 1;
+	db.commonevents[0].event_commands.resize(2);
+	db.commonevents[0].event_commands[0].code = static_cast<int32_t>(rpg::EventCommand::Code::ControlSwitches);
+	db.commonevents[0].event_commands[0].parameters = DBArray<int32_t>({ 0x0FFFFFFF });
+	auto buf = LDB_Reader::SaveToBuffer(db);
+
+	// Turn count 1 followed by the 4 byte parameter into a 5 byte count of 2^31 - 1
+	const std::vector<uint8_t> params = { 0x01, 0xFF, 0xFF, 0xFF, 0x7F };
+	auto it = std::search(buf.begin(), buf.end(), params.begin(), params.end());
+	REQUIRE(it != buf.end());
+	*it = 0x87;
+
+	auto loaded = LDB_Reader::Load(MakeSpan(buf));
+	REQUIRE(loaded != nullptr);
+	REQUIRE_EQ(loaded->commonevents.size(), 1);
+	REQUIRE_FALSE(loaded->commonevents[0].event_commands.empty());
+	REQUIRE_LT(loaded->commonevents[0].event_commands[0].parameters.size(), buf.size());
+}
+
+TEST_CASE("CorruptedMatchesStream") {
+	const auto buf = SaveTestDatabase();
+
+	// Saving the result makes databases, null results and exceptions comparable
+	auto load = [](auto&& fn) -> std::vector<uint8_t> {
+		try {
+			auto db = fn();
+			return db ? LDB_Reader::SaveToBuffer(*db) : std::vector<uint8_t>{ 0 };
+		} catch (const std::exception&) {
+			return { 1 };
+		}
+	};
+
+	LogHandler::SetLevel(LogHandler::Level::Highest);
+	size_t failures = 0;
+	for (size_t i = 0; i < buf.size(); ++i) {
+		// No continuation bit: integers cut off by the end of the file
+		// assert in debug builds
+		for (uint8_t value: { 0x00, 0x01, 0x7F }) {
+			auto mutated = buf;
+			mutated[i] = value;
+			const auto str = std::string(mutated.begin(), mutated.end());
+
+			auto from_stream = load([&]() {
+				std::istringstream is(str);
+				return LDB_Reader::Load(is);
+			});
+			auto from_memory = load([&]() {
+				return LDB_Reader::Load(MakeSpan(mutated));
+			});
+			if (from_stream != from_memory) {
+				++failures;
+			}
+		}
+	}
+	LogHandler::SetLevel(LogHandler::Level::Debug);
+	REQUIRE_EQ(failures, 0);
+}
+
+#if LCF_SUPPORT_XML
+TEST_CASE("Xml") {
+	const auto buf = SaveTestDatabase();
+	auto db = LDB_Reader::Load(MakeSpan(buf));
+	REQUIRE(db != nullptr);
+
+	std::stringstream ss;
+	REQUIRE(LDB_Reader::SaveXml(ss, *db));
+	auto xml = ss.str();
+
+	auto loaded = LDB_Reader::LoadXml(ss);
+	REQUIRE(loaded != nullptr);
+	REQUIRE(*loaded == *db);
+
+	loaded = LDB_Reader::LoadXml(Span<const uint8_t>(reinterpret_cast<const uint8_t*>(xml.data()), xml.size()));
+	REQUIRE(loaded != nullptr);
+	REQUIRE(*loaded == *db);
+
+	// Unknown fields are skipped
+	const auto pos = xml.find("<name>Brian</name>");
+	REQUIRE_NE(pos, std::string::npos);
+	xml.insert(pos, "<no_such_field>1</no_such_field>");
+	// Including their children, which must not be read as fields of the parent
+	const std::string brian = "<name>Brian</name>";
+	xml.insert(xml.find(brian) + brian.size(), "<no_such_field><name>X</name><title>Y</title></no_such_field>");
+	std::istringstream is(xml);
+	loaded = LDB_Reader::LoadXml(is);
+	REQUIRE(loaded != nullptr);
+	REQUIRE_EQ(loaded->actors[1].name, "Brian");
+	REQUIRE(loaded->actors == db->actors);
+}
+#endif
+
+TEST_SUITE_END();
@@ -0,0 +1,94 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/config.h"
+#include "lcf/lsd/reader.h"
+#include "doctest.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("LSD_Reader");
+
+static std::string SaveTestSave(int32_t codepage) {
+	rpg::Save save;
+	save.title.hero_name = "\xC3\x83 Caf\xC3\xA9";
+	save.system.graphics_name = "System";
+	save.easyrpg_data.version = 1;
+	save.easyrpg_data.codepage = codepage;
+
+	std::stringstream ss;
+	LSD_Reader::Save(ss, save, EngineVersion::e2k, "1252");
+	return ss.str();
+}
+
+#if LCF_SUPPORT_ICU
+TEST_CASE("Codepage") {
+	// The stored codepage wins over the requested encoding
+	const auto str = SaveTestSave(1252);
+	const auto buf = std::vector<uint8_t>(str.begin(), str.end());
+
+	std::istringstream is(str);
+	auto s_save = LSD_Reader::Load(is, "1250");
+	auto m_save = LSD_Reader::Load(MakeSpan(buf), "1250");
+
+	for (auto* save: { s_save.get(), m_save.get() }) {
+		REQUIRE(save != nullptr);
+		REQUIRE_EQ(save->title.hero_name, "\xC3\x83 Caf\xC3\xA9");
+		REQUIRE_EQ(save->system.graphics_name, "System");
+		REQUIRE_EQ(save->easyrpg_data.codepage, 1252);
+	}
+}
+#endif
+
+TEST_CASE("NoCodepage") {
+	const auto str = SaveTestSave(0);
+	const auto buf = std::vector<uint8_t>(str.begin(), str.end());
+
+	std::istringstream is(str);
+	auto s_save = LSD_Reader::Load(is, "1252");
+	auto m_save = LSD_Reader::Load(MakeSpan(buf), "1252");
+
+	for (auto* save: { s_save.get(), m_save.get() }) {
+		REQUIRE(save != nullptr);
+		REQUIRE_EQ(save->title.hero_name, "\xC3\x83 Caf\xC3\xA9");
+		REQUIRE_EQ(save->easyrpg_data.version, 1);
+		REQUIRE_EQ(save->easyrpg_data.codepage, 0);
+	}
+}
+
+TEST_CASE("EmptyCodepage") {
+	const auto str = SaveTestSave(1252);
+	auto buf = std::vector<uint8_t>(str.begin(), str.end());
+
+	// Turn the codepage into an empty chunk followed by an unknown empty
+	// chunk 0x7F, which must not be read as the codepage
+	const std::vector<uint8_t> codepage = { 0x01, 0x01, 0x01, 0x02, 0x02, 0x89, 0x64 };
+	auto it = std::search(buf.begin(), buf.end(), codepage.begin(), codepage.end());
+	REQUIRE(it != buf.end());
+	it[4] = 0x00;
+	it[5] = 0x7F;
+	it[6] = 0x00;
+
+	std::istringstream is(std::string(buf.begin(), buf.end()));
+	auto s_save = LSD_Reader::Load(is, "1252");
+	auto m_save = LSD_Reader::Load(MakeSpan(buf), "1252");
+
+	for (auto* save: { s_save.get(), m_save.get() }) {
+		REQUIRE(save != nullptr);
+		REQUIRE_EQ(save->title.hero_name, "\xC3\x83 Caf\xC3\xA9");
+		REQUIRE_EQ(save->easyrpg_data.codepage, 0);
+	}
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,196 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/reader_lcf.h"
+#include "lcf/writer_lcf.h"
+#include "lcf/dbbitarray.h"
+#include "doctest.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("LcfReader");
+
+static const std::vector<uint8_t> test_data = {
+	0x05, 'a', 'b', 'c', 'd', 'e', // string
+	0x81, 0x00, // compressed 128
+	0x34, 0x12, // int16
+	0x7F, // compressed 127
+};
+
+static std::string ToStr(const std::vector<uint8_t>& v) {
+	return std::string(v.begin(), v.end());
+}
+
+TEST_CASE("MemoryMatchesStream") {
+	std::istringstream ss(ToStr(test_data));
+	LcfReader s_reader(ss);
+	LcfReader m_reader(MakeSpan(test_data));
+
+	for (auto* reader: { &s_reader, &m_reader }) {
+		REQUIRE(reader->IsOk());
+		std::string str;
+		reader->ReadString(str, reader->ReadInt());
+		REQUIRE_EQ(str, "abcde");
+		REQUIRE_EQ(reader->ReadInt(), 128);
+		int16_t val = 0;
+		reader->Read(val);
+		REQUIRE_EQ(val, 0x1234);
+		REQUIRE_EQ(reader->Tell(), 10);
+		REQUIRE_EQ(reader->Peek(), 0x7F);
+		REQUIRE_EQ(reader->ReadInt(), 127);
+		REQUIRE_FALSE(reader->Eof());
+
+		// Reading past the end
+		REQUIRE_EQ(reader->ReadInt(), 0);
+		REQUIRE(reader->Eof());
+		REQUIRE_FALSE(reader->IsOk());
+	}
+}
+
+TEST_CASE("MemorySeek") {
+	LcfReader reader(MakeSpan(test_data));
+
+	reader.Seek(6);
+	REQUIRE_EQ(reader.Tell(), 6);
+	REQUIRE_EQ(reader.ReadInt(), 128);
+
+	reader.Seek(2, LcfReader::FromCurrent);
+	REQUIRE_EQ(reader.Tell(), 10);
+	REQUIRE_FALSE(reader.Eof());
+
+	// Out of bounds seeks are clamped
+	reader.Seek(100, LcfReader::FromCurrent);
+	REQUIRE_EQ(reader.Tell(), test_data.size());
+	REQUIRE(reader.Eof());
+
+	// Like a stream the reader stays failed until it is cleared
+	reader.Seek(0);
+	REQUIRE(reader.Eof());
+	REQUIRE_EQ(reader.ReadInt(), 0);
+
+	reader.Clear();
+	reader.Seek(0);
+	REQUIRE_FALSE(reader.Eof());
+	REQUIRE_EQ(reader.ReadInt(), 5);
+}
+
+TEST_CASE("MemoryShortRead") {
+	LcfReader reader(MakeSpan(test_data).subspan(0, 3));
+
+	char buf[8] = {};
+	REQUIRE_EQ(reader.Read0(buf, 1, sizeof(buf)), 3);
+	REQUIRE_EQ(reader.Tell(), 3);
+	REQUIRE(reader.Eof());
+}
+
+TEST_CASE("CompressedInts") {
+	const std::vector<int32_t> values = {
+		0, 1, 127, 128, 255, 16383, 16384, 2097151, 2097152,
+		268435455, 268435456, 2147483647, -1, -128, -2147483647 - 1, 5
+	};
+
+	std::stringstream ss;
+	{
+		LcfWriter writer(ss, EngineVersion::e2k);
+		for (auto v: values) {
+			writer.WriteInt(v);
+		}
+	}
+	const auto str = ss.str();
+	const auto buf = std::vector<uint8_t>(str.begin(), str.end());
+
+	SUBCASE("single") {
+		LcfReader reader(MakeSpan(buf));
+		for (auto v: values) {
+			REQUIRE_EQ(reader.ReadInt(), v);
+		}
+		REQUIRE_EQ(reader.Tell(), buf.size());
+	}
+
+	SUBCASE("batch") {
+		std::istringstream is(str);
+		LcfReader s_reader(is);
+		LcfReader m_reader(MakeSpan(buf));
+
+		for (auto* reader: { &s_reader, &m_reader }) {
+			std::vector<int32_t> out(values.size());
+			reader->ReadInts(out.data(), out.size());
+			REQUIRE_EQ(out, values);
+			REQUIRE_EQ(reader->Tell(), buf.size());
+		}
+	}
+
+	SUBCASE("uint64") {
+		const std::vector<uint8_t> data = {
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F, // 56 bits
+			0x81, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00, // 9 bytes
+			0, 0, 0, 0, 0, 0, 0, 0
+		};
+		LcfReader reader(MakeSpan(data));
+		REQUIRE_EQ(reader.ReadUInt64(), (UINT64_C(1) << 56) - 1);
+		REQUIRE_EQ(reader.ReadUInt64(), UINT64_C(1) << 56);
+		REQUIRE_EQ(reader.Tell(), 17);
+	}
+}
+
+TEST_CASE("CompressedIntsInvalid") {
+	// 6 byte integers are rejected
+	const std::vector<uint8_t> data = {
+		0x81, 0x81, 0x81, 0x81, 0x81, 0x01,
+		0x05, 0, 0, 0, 0, 0, 0, 0
+	};
+	LcfReader reader(MakeSpan(data));
+	int32_t out[2];
+	reader.ReadInts(out, 2);
+	REQUIRE_EQ(out[0], 0);
+	REQUIRE_EQ(out[1], 5);
+}
+
+TEST_CASE("Vectors") {
+	std::vector<uint8_t> data = {
+		0x01, 0x00, 0xFE, 0xFF, 0x7F, // int16 with odd size
+		0x04, 0x03, 0x02, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, // int32
+		0x00, 0x02, 0x00, 0x01, // bool
+	};
+	// Bits, more than one SIMD block
+	for (int i = 0; i < 37; ++i) {
+		data.push_back(i % 3 == 0 ? 0 : i);
+	}
+	std::istringstream ss(ToStr(data));
+	LcfReader s_reader(ss);
+	LcfReader m_reader(MakeSpan(data));
+
+	for (auto* reader: { &s_reader, &m_reader }) {
+		std::vector<int16_t> i16;
+		reader->Read(i16, 5);
+		REQUIRE_EQ(i16, std::vector<int16_t>{ 1, -2, 0 });
+
+		std::vector<int32_t> i32;
+		reader->Read(i32, 8);
+		REQUIRE_EQ(i32, std::vector<int32_t>{ 0x01020304, -1 });
+
+		std::vector<bool> b;
+		reader->Read(b, 4);
+		REQUIRE_EQ(b, std::vector<bool>{ false, true, false, true });
+
+		DBBitArray bits;
+		reader->ReadBits(bits, 37);
+		REQUIRE_EQ(bits.size(), 37);
+		for (int i = 0; i < 37; ++i) {
+			REQUIRE_EQ(bits[i], i % 3 != 0);
+		}
+		REQUIRE_EQ(reader->Tell(), data.size());
+	}
+}
+
+TEST_SUITE_END();
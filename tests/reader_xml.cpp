@@ -0,0 +1,133 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/reader_xml.h"
+#include "lcf/dbbitarray.h"
+#include "doctest.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("XmlReader");
+
+TEST_CASE("ReadNumber") {
+	int32_t i32 = -1;
+	XmlReader::Read(i32, " \n42 ");
+	REQUIRE_EQ(i32, 42);
+	XmlReader::Read(i32, "-7");
+	REQUIRE_EQ(i32, -7);
+	XmlReader::Read(i32, "+5");
+	REQUIRE_EQ(i32, 5);
+	XmlReader::Read(i32, "");
+	REQUIRE_EQ(i32, 0);
+	XmlReader::Read(i32, "abc");
+	REQUIRE_EQ(i32, 0);
+	XmlReader::Read(i32, "99999999999");
+	REQUIRE_EQ(i32, INT32_MAX);
+
+	int16_t i16;
+	XmlReader::Read(i16, "-40000");
+	REQUIRE_EQ(i16, INT16_MIN);
+
+	uint8_t u8;
+	XmlReader::Read(u8, "200");
+	REQUIRE_EQ(u8, 200);
+
+	uint32_t u32;
+	XmlReader::Read(u32, "4000000000");
+	REQUIRE_EQ(u32, 4000000000u);
+	// Negative values wrap around like stream extraction
+	XmlReader::Read(u32, "-1");
+	REQUIRE_EQ(u32, UINT32_MAX);
+	XmlReader::Read(u32, "-4294967295");
+	REQUIRE_EQ(u32, 1);
+	XmlReader::Read(u32, "-99999999999");
+	REQUIRE_EQ(u32, UINT32_MAX);
+
+	double d;
+	XmlReader::Read(d, "1.5");
+	REQUIRE_EQ(d, 1.5);
+	XmlReader::Read(d, "-2e3");
+	REQUIRE_EQ(d, -2000.0);
+
+	bool b;
+	XmlReader::Read(b, " T");
+	REQUIRE(b);
+	XmlReader::Read(b, "F");
+	REQUIRE_FALSE(b);
+}
+
+TEST_CASE("ReadVector") {
+	std::vector<int32_t> vec = { 9 };
+	XmlReader::Read(vec, "1 -2\n3\t 4 ");
+	REQUIRE_EQ(vec, std::vector<int32_t>{ 1, -2, 3, 4 });
+	XmlReader::Read(vec, "  ");
+	REQUIRE(vec.empty());
+
+	std::vector<bool> bools;
+	XmlReader::Read(bools, "T F T");
+	REQUIRE_EQ(bools, std::vector<bool>{ true, false, true });
+
+	DBArray<int16_t> arr = { 9, 9 };
+	XmlReader::Read(arr, "5000 1 2");
+	REQUIRE_EQ(arr, DBArray<int16_t>{ 5000, 1, 2 });
+
+	DBArray<double> doubles;
+	XmlReader::Read(doubles, "0.5 2");
+	REQUIRE_EQ(doubles, DBArray<double>{ 0.5, 2.0 });
+
+	DBBitArray bits;
+	XmlReader::Read(bits, "F T T");
+	REQUIRE_EQ(bits, DBBitArray{ false, true, true });
+}
+
+#if LCF_SUPPORT_XML
+namespace {
+class RecordingHandler : public XmlHandler {
+public:
+	void StartElement(XmlReader& /* reader */, const char* name, const char** /* atts */) override {
+		names += name;
+		names += ' ';
+	}
+	void CharacterData(XmlReader& /* reader */, const std::string& data) override {
+		text += data;
+	}
+
+	std::string names;
+	std::string text;
+};
+} // namespace
+
+TEST_CASE("Parse") {
+	const std::string doc = "<root><a>12</a><b>T</b><c/></root>";
+
+	for (size_t chunk_size: { size_t(1), size_t(7), XmlReader::default_chunk_size }) {
+		std::istringstream ss(doc);
+		XmlReader reader(ss, chunk_size);
+		RecordingHandler handler;
+		reader.SetHandler(&handler);
+		reader.Parse();
+		REQUIRE_EQ(handler.names, "root a b c ");
+		REQUIRE_EQ(handler.text, "12T");
+	}
+
+	XmlReader reader(Span<const uint8_t>(reinterpret_cast<const uint8_t*>(doc.data()), doc.size()));
+	RecordingHandler handler;
+	reader.SetHandler(&handler);
+	reader.Parse();
+	REQUIRE_EQ(handler.names, "root a b c ");
+	REQUIRE_EQ(handler.text, "12T");
+}
+#endif
+
+TEST_SUITE_END();
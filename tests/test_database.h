@@ -0,0 +1,36 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#ifndef LCF_TESTS_TEST_DATABASE_H
+#define LCF_TESTS_TEST_DATABASE_H
+
+#include "lcf/ldb/reader.h"
+
+#include <cstdint>
+#include <vector>
+
+/** @return a small database with a few actors, a skill and some strings in LDB format */
+inline std::vector<uint8_t> SaveTestDatabase() {
+	lcf::rpg::Database db;
+	db.actors.resize(2);
+	db.actors[0].ID = 1;
+	db.actors[0].name = "Alex";
+	db.actors[0].initial_level = 5;
+	db.actors[1].ID = 2;
+	db.actors[1].name = "Brian";
+	db.skills.resize(1);
+	db.skills[0].ID = 1;
+	db.skills[0].name = "Heal";
+	db.system.ldb_id = 2003;
+	db.system.title_name = "Title";
+	db.terms.menu_save = "Save";
+	return lcf::LDB_Reader::SaveToBuffer(db);
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/writer_lcf.h"
+#include "lcf/dbbitarray.h"
+#include "lcf/lmu/reader.h"
+#include "doctest.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("LcfWriter");
+
+TEST_CASE("ChunkLength") {
+	std::ostringstream ss;
+	LcfWriter writer(ss, EngineVersion::e2k);
+
+	writer.WriteInt(1);
+	auto outer = writer.BeginChunk();
+	writer.WriteInt(2);
+	auto inner = writer.BeginChunk();
+	for (int i = 0; i < 200; ++i) {
+		writer.Write<uint8_t>(0x55);
+	}
+	writer.EndChunk(inner);
+	REQUIRE_EQ(writer.Tell(), 205);
+	writer.EndChunk(outer);
+	// Nothing is written before the flush
+	REQUIRE(ss.str().empty());
+	writer.Flush();
+
+	const auto str = ss.str();
+	REQUIRE_EQ(str.size(), 206);
+	REQUIRE_EQ(str.substr(0, 6), std::string("\x01\x81\x4B\x02\x81\x48", 6));
+	REQUIRE_EQ(str.substr(6), std::string(200, '\x55'));
+}
+
+TEST_CASE("NestedChunkLengths") {
+	LcfWriter writer(EngineVersion::e2k);
+
+	auto outer = writer.BeginChunk();
+	auto empty = writer.BeginChunk();
+	writer.EndChunk(empty);
+	for (int n: { 130, 5 }) {
+		auto middle = writer.BeginChunk();
+		auto inner = writer.BeginChunk();
+		for (int i = 0; i < n; ++i) {
+			writer.Write<uint8_t>(0x55);
+		}
+		writer.EndChunk(inner);
+		writer.EndChunk(middle);
+	}
+	writer.EndChunk(outer);
+	writer.WriteInt(7);
+
+	// outer: 1 + (2 + 2 + 130) + (1 + 1 + 5) = 142 bytes
+	std::vector<uint8_t> expected = { 0x81, 0x0E, 0x00, 0x81, 0x04, 0x81, 0x02 };
+	expected.insert(expected.end(), 130, 0x55);
+	expected.insert(expected.end(), { 0x06, 0x05 });
+	expected.insert(expected.end(), 5, 0x55);
+	expected.push_back(0x07);
+	REQUIRE_EQ(writer.TakeBuffer(), expected);
+}
+
+TEST_CASE("EmptyChunk") {
+	std::ostringstream ss;
+	LcfWriter writer(ss, EngineVersion::e2k);
+
+	auto chunk = writer.BeginChunk();
+	writer.EndChunk(chunk);
+	writer.Flush();
+	REQUIRE_EQ(ss.str(), std::string("\x00", 1));
+}
+
+TEST_CASE("Memory") {
+	LcfWriter writer(EngineVersion::e2k);
+	REQUIRE(writer.IsOk());
+
+	writer.WriteInt(300);
+	writer.Write(std::vector<int16_t>{ 1, -2 });
+	writer.Write(std::vector<uint32_t>{ 0x01020304 });
+	REQUIRE_EQ(writer.Tell(), 10);
+
+	const std::vector<uint8_t> expected = {
+		0x82, 0x2C,
+		0x01, 0x00, 0xFE, 0xFF,
+		0x04, 0x03, 0x02, 0x01
+	};
+	REQUIRE_EQ(writer.TakeBuffer(), expected);
+	REQUIRE(writer.TakeBuffer().empty());
+	REQUIRE_EQ(writer.Tell(), 10);
+}
+
+TEST_CASE("FlushOnDestruction") {
+	std::ostringstream ss;
+	{
+		LcfWriter writer(ss, EngineVersion::e2k);
+		writer.WriteInt(1);
+		writer.WriteInt(2);
+		REQUIRE(ss.str().empty());
+	}
+	REQUIRE_EQ(ss.str(), std::string("\x01\x02", 2));
+}
+
+TEST_CASE("CommandStrings") {
+	// Event and move command strings are converted once for the size and
+	// the write pass. Same sizes must not reuse the result of another string.
+	rpg::EventPage page;
+	page.ID = 1;
+	for (const char* str: { "\xC3\xA4\xC3\xB6", "\xC3\xB6\xC3\xA4", "abcd", "\xC3\xA4\xC3\xB6" }) {
+		rpg::EventCommand cmd;
+		cmd.code = static_cast<int32_t>(rpg::EventCommand::Code::ShowMessage);
+		cmd.string = DBString(std::string_view(str));
+		page.event_commands.push_back(cmd);
+
+		rpg::MoveCommand move;
+		move.command_id = static_cast<int32_t>(rpg::MoveCommand::Code::change_graphic);
+		move.parameter_string = DBString(std::string_view(str));
+		page.move_route.move_commands.push_back(move);
+	}
+
+	rpg::Map map;
+	map.events.resize(1);
+	map.events[0].ID = 1;
+	map.events[0].pages.push_back(page);
+
+	const auto buf = LMU_Reader::SaveToBuffer(map, EngineVersion::e2k3, "1252");
+	auto loaded = LMU_Reader::Load(MakeSpan(buf), "1252");
+	REQUIRE(loaded != nullptr);
+	REQUIRE(loaded->events == map.events);
+}
+
+TEST_CASE("WriteTemporaries") {
+	std::ostringstream ss;
+	LcfWriter writer(ss, EngineVersion::e2k, "1252");
+
+	// The temporaries usually get the same heap address
+	for (const char* name: { "Alice1", "Bobby2" }) {
+		writer.Write(DBString(std::string_view(name)));
+	}
+	const auto chunk = writer.BeginChunk();
+	for (const char* name: { "Carol3", "Davey4" }) {
+		writer.Write(DBString(std::string_view(name)));
+	}
+	writer.EndChunk(chunk);
+	writer.Flush();
+	REQUIRE_EQ(ss.str().substr(0, 12), "Alice1Bobby2");
+	REQUIRE_NE(ss.str().find("Carol3Davey4"), std::string::npos);
+}
+
+TEST_CASE("Bits") {
+	LcfWriter writer(EngineVersion::e2k);
+
+	DBBitArray bits(37);
+	for (int i = 0; i < 37; ++i) {
+		bits[i] = i % 3 != 0;
+	}
+	writer.Write(bits);
+	writer.Write(std::vector<bool>{ true, false, true });
+
+	const auto buf = writer.TakeBuffer();
+	REQUIRE_EQ(buf.size(), 40);
+	for (int i = 0; i < 37; ++i) {
+		REQUIRE_EQ(buf[i], i % 3 != 0 ? 1 : 0);
+	}
+	REQUIRE_EQ(buf[37], 1);
+	REQUIRE_EQ(buf[38], 0);
+	REQUIRE_EQ(buf[39], 1);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,78 @@
+/*
+ * This file is part of liblcf. Copyright (c) liblcf authors.
+ * https://github.com/EasyRPG/liblcf - https://easyrpg.org
+ *
+ * liblcf is Free/Libre Open Source Software, released under the MIT License.
+ * For the full copyright and license information, please view the COPYING
+ * file that was distributed with this source code.
+ */
+
+#include "lcf/writer_xml.h"
+#include "lcf/dbarray.h"
+#include "lcf/dbstring.h"
+#include "doctest.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lcf;
+
+TEST_SUITE_BEGIN("XmlWriter");
+
+static const std::string xml_header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+
+TEST_CASE("Values") {
+	std::stringstream ss;
+	{
+		XmlWriter writer(ss, EngineVersion::e2k3);
+		writer.BeginElement("Root", 7);
+		writer.WriteNode<int32_t>("i", -42);
+		writer.WriteNode<uint32_t>("u", 4000000000u);
+		writer.WriteNode<double>("d", 0.1);
+		writer.WriteNode<bool>("b", true);
+		writer.WriteNode<std::vector<int16_t>>("v", { 1, -2, 3 });
+		writer.WriteNode<DBArray<bool>>("a", { true, false });
+		writer.EndElement("Root");
+	}
+	REQUIRE_EQ(ss.str(), xml_header +
+		"<Root id=\"0007\">\n"
+		" <i>-42</i>\n"
+		" <u>4000000000</u>\n"
+		" <d>0.1</d>\n"
+		" <b>T</b>\n"
+		" <v>1 -2 3</v>\n"
+		" <a>T F</a>\n"
+		"</Root>\n");
+}
+
+TEST_CASE("Escape") {
+	// Long enough to cover the vectorized scan and the scalar tail
+	const std::string plain(40, 'x');
+	std::stringstream ss;
+	{
+		XmlWriter writer(ss, EngineVersion::e2k3);
+		writer.WriteNode<std::string>("s", plain + "<a>&b\x01\x1f\n\r\tc" + plain + "\xe3\x81\x82");
+	}
+	REQUIRE_EQ(ss.str(), xml_header + "<s>" + plain + "&lt;a&gt;&amp;b&#xe001;&#xe01f;\n\r\tc" + plain + "\xe3\x81\x82</s>\n");
+}
+
+TEST_CASE("Compact") {
+	std::stringstream ss;
+	XmlWriter writer(ss, EngineVersion::e2k3, true);
+	writer.BeginElement("Root");
+	writer.BeginElement("Item", 12345);
+	writer.WriteNode<DBString>("name", DBString("Alex"));
+	writer.EndElement("Item");
+	writer.EndElement("Root");
+	writer.Flush();
+	REQUIRE(writer.IsOk());
+	REQUIRE_EQ(ss.str(), xml_header +
+		"<Root>\n"
+		"<Item id=\"12345\">\n"
+		"<name>Alex</name>\n"
+		"</Item>\n"
+		"</Root>\n");
+}
+
+TEST_SUITE_END();
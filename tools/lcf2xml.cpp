@@ -50,17 +50,18 @@ std::string GetFilename(const std::string& str);
 FileCategories GetFilecategory(const std::string& in_file);
 FileTypes GetFiletype(const std::string& in_file, std::string& out_extension);
 void PrintReaderError(const std::string data);
-int ReaderWriteToFile(const std::string& in, const std::string& out, FileTypes in_type, lcf::EngineVersion engine, std::string encoding);
+int ReaderWriteToFile(const std::string& in, const std::string& out, FileTypes in_type, lcf::EngineVersion engine, std::string encoding, lcf::SaveOpt xml_opt);
 
 int main(int argc, char** argv)
 {
 	if (argc <= 1)
 	{
 		std::cerr << "LCF2XML - Converts RPG Maker 2000/2003 Files into XML and vice versa" << std::endl;
-		std::cerr << "Usage: " << argv[0] << "[--2k] [--2k3] file1 [... fileN]" << std::endl;
+		std::cerr << "Usage: " << argv[0] << "[--2k] [--2k3] [--compact] file1 [... fileN]" << std::endl;
 		std::cerr << "\t--2k: Treat files as RPG 2000" << std::endl;
 		std::cerr << "\t--2k3: Treat files as RPG 2003 (default)" << std::endl;
 		std::cerr << "\t--encoding N: Use encoding N as the file encoding" << std::endl;
+		std::cerr << "\t--compact: Write XML without indentation" << std::endl;
 
 		return 1;
 	}
@@ -75,6 +76,7 @@ int main(int argc, char** argv)
 	unsigned int errors = 0;
 
 	lcf::EngineVersion engine = lcf::EngineVersion::e2k3;
+	lcf::SaveOpt xml_opt = lcf::SaveOpt::eNone;
 	for (int i = 1; i < argc; ++i) {
 		if (!std::strcmp(argv[i], "--2k")) {
 			engine = lcf::EngineVersion::e2k;
@@ -84,6 +86,10 @@ int main(int argc, char** argv)
 			engine = lcf::EngineVersion::e2k3;
 			continue;
 		}
+		if (!std::strcmp(argv[i], "--compact")) {
+			xml_opt = lcf::SaveOpt::eCompactXml;
+			continue;
+		}
 		if (!std::strcmp(argv[i], "--encoding") && (++i < argc)) {
 			encoding = argv[i];
 			continue;
@@ -106,7 +112,7 @@ int main(int argc, char** argv)
 		outfile = GetFilename(*it);
 		type = GetFiletype(*it, extension);
 		outfile += extension;
-		if (ReaderWriteToFile(*it, outfile, type, engine, encoding) != 0) {
+		if (ReaderWriteToFile(*it, outfile, type, engine, encoding, xml_opt) != 0) {
 			errors++;
 		}
 	}
@@ -247,7 +253,7 @@ void PrintReaderError(const std::string data)
 	}
 
 /** Takes data from in and writes converted data into out using liblcf. */
-int ReaderWriteToFile(const std::string& in, const std::string& out, FileTypes in_type, lcf::EngineVersion engine, std::string encoding)
+int ReaderWriteToFile(const std::string& in, const std::string& out, FileTypes in_type, lcf::EngineVersion engine, std::string encoding, lcf::SaveOpt xml_opt)
 {
 	std::string path = GetPath(in) + "/";
 
@@ -287,28 +293,28 @@ int ReaderWriteToFile(const std::string& in, const std::string& out, FileTypes i
 		{
 			auto file = lcf::LMU_Reader::Load(in, encoding);
 			LCFXML_ERROR(file == nullptr, "LMU load");
-			LCFXML_ERROR(!lcf::LMU_Reader::SaveXml(out, *file, engine), "LMU XML save");
+			LCFXML_ERROR(!lcf::LMU_Reader::SaveXml(out, *file, engine, xml_opt), "LMU XML save");
 			break;
 		}
 		case FileType_LCF_SaveData:
 		{
 			auto file = lcf::LSD_Reader::Load(in, encoding);
 			LCFXML_ERROR(file == nullptr, "LSD load");
-			LCFXML_ERROR(!lcf::LSD_Reader::SaveXml(out, *file, engine), "LSD XML save");
+			LCFXML_ERROR(!lcf::LSD_Reader::SaveXml(out, *file, engine, xml_opt), "LSD XML save");
 			break;
 		}
 		case FileType_LCF_Database:
 		{
 			auto file = lcf::LDB_Reader::Load(in, encoding);
 			LCFXML_ERROR(file.get() == nullptr, "LDB load");
-			LCFXML_ERROR(!lcf::LDB_Reader::SaveXml(out, *file), "LDB XML save");
+			LCFXML_ERROR(!lcf::LDB_Reader::SaveXml(out, *file, xml_opt), "LDB XML save");
 			break;
 		}
 		case FileType_LCF_MapTree:
 		{
 			auto file = lcf::LMT_Reader::Load(in, encoding);
 			LCFXML_ERROR(file == nullptr, "LMT load");
-			LCFXML_ERROR(!lcf::LMT_Reader::SaveXml(out, *file, engine), "LMT XML save");
+			LCFXML_ERROR(!lcf::LMT_Reader::SaveXml(out, *file, engine, xml_opt), "LMT XML save");
 			break;
 		}
 		case FileType_XML_MapUnit: